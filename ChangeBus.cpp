@@ -0,0 +1,60 @@
+#include "ChangeBus.h"
+#include <iostream>
+#include <mutex>
+
+void ChangeBus::setSnapshotProvider(std::function<void(std::vector<DeviceChangeEvent>&)> provider) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    snapshotProvider = std::move(provider);
+}
+
+int ChangeBus::subscribe(const std::string& name, size_t queueCapacity) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    subscribers.push_back(std::make_unique<Subscriber>(name, queueCapacity));
+    return static_cast<int>(subscribers.size()) - 1;
+}
+
+void ChangeBus::unsubscribe(int subscriberId) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    if (subscriberId >= 0 && static_cast<size_t>(subscriberId) < subscribers.size())
+        subscribers[static_cast<size_t>(subscriberId)].reset();
+}
+
+void ChangeBus::publish(const DeviceChangeEvent& event) {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    for (auto& sub : subscribers) {
+        if (!sub) continue;
+        if (!sub->ring.tryPush(event))
+            sub->missed.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+ChangeBatch ChangeBus::poll(int subscriberId, size_t maxEvents) {
+    ChangeBatch batch;
+    std::function<void(std::vector<DeviceChangeEvent>&)> provider;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        if (subscriberId < 0 || static_cast<size_t>(subscriberId) >= subscribers.size()) return batch;
+        Subscriber* sub = subscribers[static_cast<size_t>(subscriberId)].get();
+        if (!sub) return batch;
+
+        batch.events.resize(maxEvents);
+        batch.events.resize(sub->ring.popBatch(batch.events.data(), maxEvents));
+        sub->delivered.fetch_add(batch.events.size(), std::memory_order_relaxed);
+
+        batch.missed = sub->missed.exchange(0, std::memory_order_acq_rel);
+        if (batch.missed > 0) provider = snapshotProvider;
+    }
+    // outside the bus lock: the provider takes the state table's lock, which publishers hold
+    if (provider) provider(batch.resync);
+    return batch;
+}
+
+void ChangeBus::printStats() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    std::cout << "\nChange Bus Subscribers:\n";
+    for (const auto& sub : subscribers) {
+        if (!sub) continue;
+        std::cout << "  • " << sub->name << " | delivered: " << sub->delivered.load()
+                  << " | pending missed: " << sub->missed.load() << "\n";
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef CHANGEBUS_H
+#define CHANGEBUS_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+#include "Device.h"
+#include "RingBuffer.h"
+
+// Fixed-size record of one device state or attribute change
+struct DeviceChangeEvent {
+    int deviceId;
+    DeviceState oldState;
+    DeviceState newState;
+    ChangeSource source;
+    uint32_t version;          // device version after the change
+    DeviceAttribute attribute; // NONE for a state change
+    int32_t oldValue;          // attribute values, only for attribute changes
+    int32_t newValue;
+};
+
+// What a subscriber gets back from poll()
+struct ChangeBatch {
+    std::vector<DeviceChangeEvent> events;
+    unsigned long long missed = 0; // events dropped since the last poll
+    // when missed > 0: current state of every device (oldState == newState, source SYSTEM),
+    // followed by one event per attribute with its current value (oldValue == newValue)
+    std::vector<DeviceChangeEvent> resync;
+};
+
+// Publish/subscribe bus for device changes. Every subscriber has its own bounded
+// ring; publishing never waits for a subscriber. If a ring is full the event is
+// dropped for that subscriber only and counted, and its next poll() reports how
+// many events it missed together with the latest state of all devices.
+class ChangeBus {
+private:
+    struct Subscriber {
+        std::string name;
+        MpscRing<DeviceChangeEvent> ring;
+        std::atomic<unsigned long long> missed{0};
+        std::atomic<unsigned long long> delivered{0};
+        Subscriber(const std::string& name, size_t capacity) : name(name), ring(capacity) {}
+    };
+
+    std::vector<std::unique_ptr<Subscriber>> subscribers; // unsubscribed slots are null
+    mutable std::shared_mutex mutex; // publish shares it; subscribe/unsubscribe take it exclusively
+    std::function<void(std::vector<DeviceChangeEvent>&)> snapshotProvider;
+
+public:
+    ChangeBus() = default;
+    ChangeBus(const ChangeBus&) = delete;
+    ChangeBus& operator=(const ChangeBus&) = delete;
+
+    // fills a list with the current state of every device; used for resync after drops
+    void setSnapshotProvider(std::function<void(std::vector<DeviceChangeEvent>&)> provider);
+
+    int subscribe(const std::string& name, size_t queueCapacity = 1024);
+    void unsubscribe(int subscriberId);
+
+    void publish(const DeviceChangeEvent& event);
+
+    // drain up to maxEvents queued events for one subscriber (single consumer per subscriber)
+    ChangeBatch poll(int subscriberId, size_t maxEvents = 1024);
+
+    void printStats() const;
+};
+
+#endif // CHANGEBUS_H
@@ -6,7 +6,7 @@
 DatabaseManager::DatabaseManager(const std::string& dbFile)
     : db(nullptr), dbFilePath(dbFile) 
 {
-    if (!openConnection()) {
+    if (!openLocked()) {
         std::cerr << "[DatabaseManager] Failed to open database: " << dbFilePath << std::endl;
     } else {
         // Optional: Create tables if not exist
@@ -22,6 +22,8 @@ DatabaseManager::DatabaseManager(const std::string& dbFile)
             "type INTEGER,"
             "state INTEGER,"
             "room_id INTEGER,"
+            "attr0 INTEGER,"
+            "attr1 INTEGER,"
             "FOREIGN KEY(room_id) REFERENCES rooms(id));";
 
         char* errMsg = nullptr;
@@ -29,7 +31,37 @@ DatabaseManager::DatabaseManager(const std::string& dbFile)
         if (errMsg) { std::cerr << "SQL error: " << errMsg << std::endl; sqlite3_free(errMsg); }
         sqlite3_exec(db, createDevices, nullptr, nullptr, &errMsg);
         if (errMsg) { std::cerr << "SQL error: " << errMsg << std::endl; sqlite3_free(errMsg); }
+
+        // databases created before device attributes existed
+        ensureColumn("devices", "attr0", "INTEGER");
+        ensureColumn("devices", "attr1", "INTEGER");
+    }
+}
+
+bool DatabaseManager::ensureColumn(const std::string& table, const std::string& column, const std::string& decl) {
+    std::string pragma = "PRAGMA table_info(" + table + ");";
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, pragma.c_str(), -1, &stmt, nullptr) != SQLITE_OK) return false;
+
+    bool found = false;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const unsigned char* name = sqlite3_column_text(stmt, 1);
+        if (name && column == reinterpret_cast<const char*>(name)) {
+            found = true;
+            break;
+        }
+    }
+    sqlite3_finalize(stmt);
+    if (found) return true;
+
+    std::string alter = "ALTER TABLE " + table + " ADD COLUMN " + column + " " + decl + ";";
+    char* errMsg = nullptr;
+    if (sqlite3_exec(db, alter.c_str(), nullptr, nullptr, &errMsg) != SQLITE_OK) {
+        std::cerr << "SQL error: " << (errMsg ? errMsg : "unknown") << std::endl;
+        sqlite3_free(errMsg);
+        return false;
     }
+    return true;
 }
 
 DatabaseManager::~DatabaseManager() {
@@ -37,6 +69,11 @@ DatabaseManager::~DatabaseManager() {
 }
 
 bool DatabaseManager::openConnection() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return openLocked();
+}
+
+bool DatabaseManager::openLocked() {
     if (db) return true; // already open
 
     int rc = sqlite3_open(dbFilePath.c_str(), &db);
@@ -49,6 +86,7 @@ bool DatabaseManager::openConnection() {
 }
 
 void DatabaseManager::closeConnection() {
+    std::lock_guard<std::mutex> lock(mutex);
     if (db) {
         sqlite3_close(db);
         db = nullptr;
@@ -76,7 +114,8 @@ bool DatabaseManager::executeSQLFile(const std::string& filePath) {
 }
 
 bool DatabaseManager::initializeDatabase(const std::string& schemaFile, const std::string& sampleDataFile) {
-    if (!openConnection()) return false;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!openLocked()) return false;
 
     if (!executeSQLFile(schemaFile)) return false;
     if (!executeSQLFile(sampleDataFile)) return false;
@@ -84,9 +123,10 @@ bool DatabaseManager::initializeDatabase(const std::string& schemaFile, const st
     return true;
 }
 
-std::vector<std::shared_ptr<Room>> DatabaseManager::loadRooms() {
+std::vector<std::shared_ptr<Room>> DatabaseManager::loadRooms(const std::shared_ptr<HomeArena>& arena) {
+    std::lock_guard<std::mutex> lock(mutex);
     std::vector<std::shared_ptr<Room>> rooms;
-    if (!db && !openConnection()) return rooms;
+    if (!db && !openLocked()) return rooms;
 
     const char* sql = "SELECT id, name FROM rooms;";
     sqlite3_stmt* stmt = nullptr;
@@ -100,7 +140,7 @@ std::vector<std::shared_ptr<Room>> DatabaseManager::loadRooms() {
         int id = sqlite3_column_int(stmt, 0);
         const unsigned char* nameText = sqlite3_column_text(stmt, 1);
         std::string name = nameText ? reinterpret_cast<const char*>(nameText) : "Unnamed Room";
-        auto room = std::make_shared<Room>(id, name);
+        auto room = arena ? arena->makeRoom(id, name) : std::make_shared<Room>(id, name);
         rooms.push_back(room);
     }
 
@@ -109,7 +149,8 @@ std::vector<std::shared_ptr<Room>> DatabaseManager::loadRooms() {
 }
 
 bool DatabaseManager::saveRoom(const Room& room) {
-    if (!db && !openConnection()) return false;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!db && !openLocked()) return false;
 
     const char* sql = "INSERT OR REPLACE INTO rooms (id, name) VALUES (?, ?);";
     sqlite3_stmt* stmt = nullptr;
@@ -120,7 +161,7 @@ bool DatabaseManager::saveRoom(const Room& room) {
     }
 
     sqlite3_bind_int(stmt, 1, room.getId());
-    sqlite3_bind_text(stmt, 2, room.getName().c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, room.getName().data(), static_cast<int>(room.getName().size()), SQLITE_TRANSIENT);
 
     if (sqlite3_step(stmt) != SQLITE_DONE) {
         std::cerr << "Failed to save room: " << sqlite3_errmsg(db) << std::endl;
@@ -130,11 +171,12 @@ bool DatabaseManager::saveRoom(const Room& room) {
     return true;
 }
 
-std::vector<std::shared_ptr<Device>> DatabaseManager::loadDevices(int roomId) {
+std::vector<std::shared_ptr<Device>> DatabaseManager::loadDevices(int roomId, const std::shared_ptr<HomeArena>& arena) {
+    std::lock_guard<std::mutex> lock(mutex);
     std::vector<std::shared_ptr<Device>> devices;
-    if (!db && !openConnection()) return devices;
+    if (!db && !openLocked()) return devices;
 
-    const char* sql = "SELECT id, name, type, state FROM devices WHERE room_id = ?;";
+    const char* sql = "SELECT id, name, type, state, attr0, attr1 FROM devices WHERE room_id = ?;";
     sqlite3_stmt* stmt = nullptr;
 
     if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
@@ -154,8 +196,13 @@ std::vector<std::shared_ptr<Device>> DatabaseManager::loadDevices(int roomId) {
         DeviceType type = static_cast<DeviceType>(typeInt);
         DeviceState state = static_cast<DeviceState>(stateInt);
 
-        auto device = std::make_shared<Device>(id, name, type);
-        device->setState(state);
+        auto device = arena ? arena->makeDevice(id, name, type) : std::make_shared<Device>(id, name, type);
+        device->setState(state, ChangeSource::SYSTEM);
+        // NULL attribute columns keep the type's default
+        for (int i = 0; i < MAX_DEVICE_ATTRIBUTES; ++i) {
+            if (sqlite3_column_type(stmt, 4 + i) != SQLITE_NULL)
+                device->setAttributeAt(i, sqlite3_column_int(stmt, 4 + i), ChangeSource::SYSTEM);
+        }
         devices.push_back(device);
     }
 
@@ -163,23 +210,36 @@ std::vector<std::shared_ptr<Device>> DatabaseManager::loadDevices(int roomId) {
     return devices;
 }
 
+static const char* SAVE_DEVICE_SQL =
+    "INSERT OR REPLACE INTO devices (id, name, type, state, room_id, attr0, attr1) "
+    "VALUES (?, ?, ?, ?, ?, ?, ?);";
+
+void DatabaseManager::bindDevice(sqlite3_stmt* stmt, const Device& device, int roomId) {
+    sqlite3_bind_int(stmt, 1, device.getId());
+    sqlite3_bind_text(stmt, 2, device.getName().data(), static_cast<int>(device.getName().size()), SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 3, static_cast<int>(device.getType()));
+    sqlite3_bind_int(stmt, 4, static_cast<int>(device.getState()));
+    sqlite3_bind_int(stmt, 5, roomId);
+    for (int i = 0; i < MAX_DEVICE_ATTRIBUTES; ++i) {
+        if (attributeSpec(device.getType(), i).attribute == DeviceAttribute::NONE)
+            sqlite3_bind_null(stmt, 6 + i);
+        else
+            sqlite3_bind_int(stmt, 6 + i, device.getAttributeAt(i));
+    }
+}
+
 bool DatabaseManager::saveDevice(const Device& device, int roomId) {
-    if (!db && !openConnection()) return false;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!db && !openLocked()) return false;
 
-    const char* sql =
-        "INSERT OR REPLACE INTO devices (id, name, type, state, room_id) VALUES (?, ?, ?, ?, ?);";
     sqlite3_stmt* stmt = nullptr;
 
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    if (sqlite3_prepare_v2(db, SAVE_DEVICE_SQL, -1, &stmt, nullptr) != SQLITE_OK) {
         std::cerr << "Failed to prepare device save query.\n";
         return false;
     }
 
-    sqlite3_bind_int(stmt, 1, device.getId());
-    sqlite3_bind_text(stmt, 2, device.getName().c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int(stmt, 3, static_cast<int>(device.getType()));
-    sqlite3_bind_int(stmt, 4, static_cast<int>(device.getState()));
-    sqlite3_bind_int(stmt, 5, roomId);
+    bindDevice(stmt, device, roomId);
 
     if (sqlite3_step(stmt) != SQLITE_DONE) {
         std::cerr << "Failed to save device: " << sqlite3_errmsg(db) << std::endl;
@@ -188,3 +248,34 @@ bool DatabaseManager::saveDevice(const Device& device, int roomId) {
     sqlite3_finalize(stmt);
     return true;
 }
+
+bool DatabaseManager::saveDevices(const std::vector<std::pair<const Device*, int>>& devices) {
+    if (devices.empty()) return true;
+    std::lock_guard<std::mutex> lock(mutex); // held from BEGIN to COMMIT/ROLLBACK
+    if (!db && !openLocked()) return false;
+
+    char* errMsg = nullptr;
+    if (sqlite3_exec(db, "BEGIN IMMEDIATE;", nullptr, nullptr, &errMsg) != SQLITE_OK) {
+        std::cerr << "Failed to begin transaction: " << (errMsg ? errMsg : "") << std::endl;
+        sqlite3_free(errMsg);
+        return false;
+    }
+
+    sqlite3_stmt* stmt = nullptr;
+    bool ok = sqlite3_prepare_v2(db, SAVE_DEVICE_SQL, -1, &stmt, nullptr) == SQLITE_OK;
+    for (size_t i = 0; ok && i < devices.size(); ++i) {
+        bindDevice(stmt, *devices[i].first, devices[i].second);
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+        sqlite3_reset(stmt);
+    }
+    if (!ok) std::cerr << "Failed to save devices: " << sqlite3_errmsg(db) << std::endl;
+    sqlite3_finalize(stmt);
+
+    if (ok && sqlite3_exec(db, "COMMIT;", nullptr, nullptr, &errMsg) == SQLITE_OK) return true;
+    if (errMsg) {
+        std::cerr << "Failed to commit devices: " << errMsg << std::endl;
+        sqlite3_free(errMsg);
+    }
+    sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+    return false;
+}
@@ -12,15 +12,26 @@ extern "C" {
 #include <string>
 #include <vector>
 #include <memory>
+#include <mutex>
+#include <utility>
 #include "Room.h"
 #include "Device.h"
+#include "HomeArena.h"
 
 class DatabaseManager {
 private:
     sqlite3* db;
     std::string dbFilePath;
+    // One connection is shared by every caller (UI, scene applies, scheduled
+    // transitions). Public methods hold this for their whole use of db, so a
+    // transaction runs from BEGIN to COMMIT/ROLLBACK without interleaving.
+    std::mutex mutex;
 
+    bool openLocked();
     bool executeSQLFile(const std::string& filePath);
+    // adds a column to an existing table if it is missing (schema upgrades)
+    bool ensureColumn(const std::string& table, const std::string& column, const std::string& decl);
+    void bindDevice(sqlite3_stmt* stmt, const Device& device, int roomId);
 
 public:
     explicit DatabaseManager(const std::string& dbFile = "smarthome.db");
@@ -31,12 +42,14 @@ public:
 
     bool initializeDatabase(const std::string& schemaFile, const std::string& sampleDataFile);
 
-    // CRUD methods
-    std::vector<std::shared_ptr<Room>> loadRooms();
+    // CRUD methods; loaded objects come from arena when one is given
+    std::vector<std::shared_ptr<Room>> loadRooms(const std::shared_ptr<HomeArena>& arena = nullptr);
     bool saveRoom(const Room& room);
 
-    std::vector<std::shared_ptr<Device>> loadDevices(int roomId);
+    std::vector<std::shared_ptr<Device>> loadDevices(int roomId, const std::shared_ptr<HomeArena>& arena = nullptr);
     bool saveDevice(const Device& device, int roomId);
+    // saves (device, roomId) pairs in one transaction; nothing is written on failure
+    bool saveDevices(const std::vector<std::pair<const Device*, int>>& devices);
 };
 
 #endif // DATABASEMANAGER_H
@@ -1,68 +1,155 @@
 #include "Device.h"
+#include "DeviceStateTable.h"
+#include "HomeArena.h"
 
-Device::Device(int id, const std::string& name, DeviceType type)
-    : id(id), name(name), type(type), state(DeviceState::OFF) {}
+Device::Device(int id, std::string_view name, DeviceType type, NamePool* names)
+    : id(id), name((names ? *names : NamePool::shared()).intern(name)), type(type), ownWord(packStateWord(DeviceState::OFF, 0)), stateWord(&ownWord),
+      attrs(ownAttrs) {
+    for (int i = 0; i < MAX_DEVICE_ATTRIBUTES; ++i)
+        ownAttrs[i].store(attributeSpec(type, i).initial, std::memory_order_relaxed);
+}
 
-Device::~Device() {}
+Device::~Device() {
+    if (table) table->release(stateSlot);
+}
 
 int Device::getId() const {
     return id;
 }
 
-std::string Device::getName() const {
-    return name;
-}
-
 DeviceType Device::getType() const {
     return type;
 }
 
-DeviceState Device::getState() const {
-    return state;
+void Device::bindStateSlot(DeviceStateTable* owner, int slot) {
+    std::atomic<uint32_t>* slotWord = owner->stateRef(slot);
+    std::atomic<int32_t>* slotAttrs = owner->attributesRef(slot);
+    for (int i = 0; i < MAX_DEVICE_ATTRIBUTES; ++i)
+        slotAttrs[i].store(attrs[i].load(std::memory_order_acquire), std::memory_order_relaxed);
+    slotWord->store(stateWord->load(std::memory_order_acquire), std::memory_order_release);
+    attrs = slotAttrs;
+    stateWord = slotWord;
+    stateSlot = slot;
+    table = owner;
 }
 
-void Device::turnOn() {
-    state = DeviceState::ON;
+void Device::unbindStateSlot() {
+    for (int i = 0; i < MAX_DEVICE_ATTRIBUTES; ++i)
+        ownAttrs[i].store(attrs[i].load(std::memory_order_acquire), std::memory_order_relaxed);
+    ownWord.store(stateWord->load(std::memory_order_acquire), std::memory_order_release);
+    attrs = ownAttrs;
+    stateWord = &ownWord;
+    stateSlot = -1;
+    table = nullptr;
 }
 
-void Device::turnOff() {
-    state = DeviceState::OFF;
+void Device::publishChange(DeviceState oldState, uint32_t newWord, ChangeSource source) {
+    if (table) table->recordStateChange(stateSlot, id, type, oldState, newWord, source);
 }
 
-void Device::activate() {
-    state = DeviceState::ACTIVE;
+DeviceSnapshot Device::snapshot() const {
+    uint32_t word = stateWord->load(std::memory_order_acquire);
+    return {wordState(word), wordVersion(word)};
 }
 
-void Device::deactivate() {
-    state = DeviceState::INACTIVE;
+uint32_t Device::getVersion() const {
+    return wordVersion(stateWord->load(std::memory_order_acquire));
 }
 
-void Device::setState(DeviceState newState) {
-    state = newState;
+DeviceState Device::exchangeState(DeviceState newState, ChangeSource source) {
+    // the table's counters must see the CAS and the count update together
+    std::shared_lock<std::shared_mutex> guard;
+    if (table) guard = table->changeLock();
+    uint32_t cur = stateWord->load(std::memory_order_acquire);
+    for (;;) {
+        if (wordState(cur) == newState) return newState;
+        uint32_t next = packStateWord(newState, wordVersion(cur) + 1);
+        if (stateWord->compare_exchange_weak(cur, next, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            publishChange(wordState(cur), next, source);
+            return wordState(cur);
+        }
+    }
 }
 
-void Device::toggle() {
-    if (type == DeviceType::SENSOR) {
-        if (state == DeviceState::ACTIVE) {
-            deactivate();
-        } else {
-            activate();
-        }
-    } else {
-        if (state == DeviceState::ON) {
-            turnOff();
-        } else {
-            turnOn();
+bool Device::compareAndSetState(DeviceState expected, DeviceState desired, ChangeSource source) {
+    std::shared_lock<std::shared_mutex> guard;
+    if (table) guard = table->changeLock();
+    uint32_t cur = stateWord->load(std::memory_order_acquire);
+    for (;;) {
+        if (wordState(cur) != expected) return false;
+        if (expected == desired) return true;
+        uint32_t next = packStateWord(desired, wordVersion(cur) + 1);
+        if (stateWord->compare_exchange_weak(cur, next, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            publishChange(expected, next, source);
+            return true;
         }
     }
 }
 
+bool Device::toggleIfStill(DeviceState expected, ChangeSource source) {
+    return compareAndSetState(expected, toggledState(type, expected), source);
+}
+
+bool Device::supportsAttribute(DeviceAttribute attribute) const {
+    return attributeIndex(type, attribute) >= 0;
+}
+
+int32_t Device::getAttribute(DeviceAttribute attribute) const {
+    int index = attributeIndex(type, attribute);
+    return index < 0 ? 0 : getAttributeAt(index);
+}
+
+bool Device::setAttribute(DeviceAttribute attribute, int32_t value, ChangeSource source) {
+    int index = attributeIndex(type, attribute);
+    if (index < 0) return false;
+    setAttributeAt(index, value, source);
+    return true;
+}
+
+int32_t Device::getAttributeAt(int index) const {
+    if (index < 0 || index >= MAX_DEVICE_ATTRIBUTES) return 0;
+    return attrs[index].load(std::memory_order_acquire);
+}
+
+void Device::setAttributeAt(int index, int32_t value, ChangeSource source) {
+    const AttributeSpec& spec = attributeSpec(type, index);
+    if (spec.attribute == DeviceAttribute::NONE) return;
+    if (value < spec.minValue) value = spec.minValue;
+    if (value > spec.maxValue) value = spec.maxValue;
+
+    int32_t old = attrs[index].exchange(value, std::memory_order_acq_rel);
+    if (old == value) return;
+    // attribute changes count as a new version of the device too
+    uint32_t word = stateWord->fetch_add(1u << 8, std::memory_order_acq_rel) + (1u << 8);
+    if (table) table->recordAttributeChange(id, word, spec.attribute, old, value, source);
+}
+
+void Device::turnOn(ChangeSource source) {
+    exchangeState(DeviceState::ON, source);
+}
+
+void Device::turnOff(ChangeSource source) {
+    exchangeState(DeviceState::OFF, source);
+}
+
+void Device::activate(ChangeSource source) {
+    exchangeState(DeviceState::ACTIVE, source);
+}
+
+void Device::deactivate(ChangeSource source) {
+    exchangeState(DeviceState::INACTIVE, source);
+}
+
+void Device::setState(DeviceState newState, ChangeSource source) {
+    exchangeState(newState, source);
+}
+
+void Device::toggle(ChangeSource source) {
+    // retry until the toggle lands on the state we actually observed
+    DeviceState current = getState();
+    while (!toggleIfStill(current, source)) current = getState();
+}
+
 std::string Device::getStateString() const {
-    switch (state) {
-        case DeviceState::ON: return "ON";
-        case DeviceState::OFF: return "OFF";
-        case DeviceState::ACTIVE: return "ACTIVE";
-        case DeviceState::INACTIVE: return "INACTIVE";
-        default: return "UNKNOWN";
-    }
+    return std::string(getStateName());
 }
@@ -2,45 +2,121 @@
 #define DEVICE_H
 
 #include <string>
+#include <cstdint>
+#include <atomic>
+#include <string_view>
+#include "DeviceTraits.h"
 
-enum class DeviceType {
-    LIGHT,
-    FAN,
-    AC,
-    SENSOR
+// Who caused a state change (carried on change events)
+enum class ChangeSource : uint8_t {
+    MANUAL,
+    SCHEDULE,
+    RULE,
+    SCENE,
+    SYSTEM
 };
 
-enum class DeviceState {
-    OFF,
-    ON,
-    ACTIVE,  // For sensors or special states
-    INACTIVE
+class DeviceStateTable;
+class NamePool;
+
+// A device's state is one atomic word: the low byte holds the DeviceState and the
+// upper 24 bits a version that is bumped on every change (wraps after 2^24 changes).
+// Reading the word once gives a consistent (state, version) pair without locks.
+inline uint32_t packStateWord(DeviceState s, uint32_t version) {
+    return (version << 8) | static_cast<uint8_t>(s);
+}
+inline DeviceState wordState(uint32_t word) { return static_cast<DeviceState>(word & 0xFFu); }
+inline uint32_t wordVersion(uint32_t word) { return word >> 8; }
+
+struct DeviceSnapshot {
+    DeviceState state;
+    uint32_t version;
 };
 
 class Device {
 protected:
     int id;
-    std::string name;
+    std::string_view name;            // interned; lives as long as the pool it came from
     DeviceType type;
-    DeviceState state;
+    std::atomic<uint32_t> ownWord;    // state word while the device is not in a DeviceStateTable
+    std::atomic<uint32_t>* stateWord; // points at ownWord or at the device's slot in the table
+    std::atomic<int32_t> ownAttrs[MAX_DEVICE_ATTRIBUTES];
+    std::atomic<int32_t>* attrs;      // ownAttrs or the slot's attribute pair in the table
+    int stateSlot = -1;
+    DeviceStateTable* table = nullptr; // set from the first registration on; told about every change
+    bool customBehavior = true;       // false only for plain Devices, see apply()
+
+    // atomically move to newState (bumping the version if it changes); returns the old state
+    DeviceState exchangeState(DeviceState newState, ChangeSource source);
+    void publishChange(DeviceState oldState, uint32_t newWord, ChangeSource source);
 
 public:
-    Device(int id, const std::string& name, DeviceType type);
+    // the name is interned into names (a HomeArena's pool) or the shared pool
+    Device(int id, std::string_view name, DeviceType type, NamePool* names = nullptr);
     virtual ~Device();
+    Device(const Device&) = delete;
+    Device& operator=(const Device&) = delete;
+
+    // Called by DeviceRegistry when the device is first registered: move the state
+    // into a table slot, which the device keeps until it or the table goes away.
+    // unbindStateSlot is for the table's destructor only; neither may race with use.
+    void bindStateSlot(DeviceStateTable* owner, int slot);
+    void unbindStateSlot();
+    int getStateSlot() const { return stateSlot; }
+    DeviceStateTable* getStateTable() const { return table; }
+    // set by DeviceRegistry when it knows whether the object is a subclass
+    void setCustomBehavior(bool custom) { customBehavior = custom; }
 
     int getId() const;
-    std::string getName() const;
+    std::string_view getName() const { return name; }
     DeviceType getType() const;
-    DeviceState getState() const;
+    DeviceState getState() const { return wordState(stateWord->load(std::memory_order_acquire)); }
+    DeviceSnapshot snapshot() const;
+    uint32_t getVersion() const;
+
+    // Compare-and-swap transitions; false if the state was no longer `expected`
+    bool compareAndSetState(DeviceState expected, DeviceState desired,
+                            ChangeSource source = ChangeSource::MANUAL);
+    bool toggleIfStill(DeviceState expected, ChangeSource source = ChangeSource::MANUAL);
 
-    virtual void turnOn();
-    virtual void turnOff();
-    virtual void activate();
-    virtual void deactivate();
-    virtual void setState(DeviceState newState);
-    virtual void toggle();
+    // Numeric attributes; values are clamped to the type's range.
+    // setAttribute returns false if the device type has no such attribute.
+    bool supportsAttribute(DeviceAttribute attribute) const;
+    int32_t getAttribute(DeviceAttribute attribute) const;
+    bool setAttribute(DeviceAttribute attribute, int32_t value, ChangeSource source = ChangeSource::MANUAL);
+    int32_t getAttributeAt(int index) const;
+    void setAttributeAt(int index, int32_t value, ChangeSource source = ChangeSource::MANUAL);
+
+    virtual void turnOn(ChangeSource source = ChangeSource::MANUAL);
+    virtual void turnOff(ChangeSource source = ChangeSource::MANUAL);
+    virtual void activate(ChangeSource source = ChangeSource::MANUAL);
+    virtual void deactivate(ChangeSource source = ChangeSource::MANUAL);
+    virtual void setState(DeviceState newState, ChangeSource source = ChangeSource::MANUAL);
+    virtual void toggle(ChangeSource source = ChangeSource::MANUAL);
 
     virtual std::string getStateString() const;
+
+    // Non-virtual hot path used by scenes, rules, schedules and the UI. Plain
+    // Devices go straight to the state word using the DeviceTraits table;
+    // subclasses (custom device classes) are still routed through the virtuals.
+    // Returns true if the state changed.
+    bool apply(DeviceState newState, ChangeSource source = ChangeSource::MANUAL) {
+        if (customBehavior) {
+            DeviceState before = getState();
+            setState(newState, source);
+            return before != newState && getState() == newState;
+        }
+        return exchangeState(newState, source) != newState;
+    }
+    void applyToggle(ChangeSource source = ChangeSource::MANUAL) {
+        if (customBehavior) {
+            toggle(source);
+            return;
+        }
+        DeviceState current = getState();
+        while (!toggleIfStill(current, source)) current = getState();
+    }
+    std::string_view getStateName() const { return stateName(getState()); }
 };
 
 #endif // DEVICE_H
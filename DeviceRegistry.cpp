@@ -0,0 +1,180 @@
+#include "DeviceRegistry.h"
+#include "Room.h"
+#include <mutex>
+#include <typeinfo>
+
+const DeviceRegistry::Entry* DeviceRegistry::findEntry(int deviceId) const {
+    if (deviceId >= 0 && deviceId < DENSE_LIMIT) {
+        if (static_cast<size_t>(deviceId) >= dense.size()) return nullptr;
+        const Entry& e = dense[static_cast<size_t>(deviceId)];
+        return e.device ? &e : nullptr;
+    }
+    auto it = sparse.find(deviceId);
+    return it == sparse.end() ? nullptr : &it->second;
+}
+
+DeviceRegistry::DeviceRegistry() {
+    table.setChangeBus(&bus);
+    bus.setSnapshotProvider([this](std::vector<DeviceChangeEvent>& out) { table.snapshot(out); });
+}
+
+bool DeviceRegistry::add(const std::shared_ptr<Device>& device, const std::shared_ptr<Room>& room) {
+    if (!device) return false;
+    int id = device->getId();
+    // a device's state lives in the table it was first registered with
+    DeviceStateTable* bound = device->getStateTable();
+    if (bound && bound != &table) return false;
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    Entry* slot;
+    if (id >= 0 && id < DENSE_LIMIT) {
+        if (static_cast<size_t>(id) >= dense.size()) dense.resize(static_cast<size_t>(id) + 1);
+        slot = &dense[static_cast<size_t>(id)];
+    } else {
+        slot = &sparse[id];
+    }
+
+    if (slot->device && slot->device != device) return false;
+    int roomId = room ? room->getId() : -1;
+    if (!slot->device) {
+        count++;
+        if (bound) {
+            table.setRoom(device->getStateSlot(), roomId); // registered again after remove()
+        } else {
+            int stateSlot = table.allocate(device.get(), id, device->getType(), roomId, device->getState());
+            device->bindStateSlot(&table, stateSlot);
+            device->setCustomBehavior(typeid(*device) != typeid(Device));
+        }
+    } else {
+        table.setRoom(device->getStateSlot(), roomId);
+    }
+    slot->device = device;
+    slot->room = room;
+    generation.fetch_add(1, std::memory_order_acq_rel);
+    return true;
+}
+
+void DeviceRegistry::detachSlot(Device& device) {
+    // the device keeps its slot (it may still be in use); it just stops being counted
+    if (device.getStateSlot() >= 0) table.detach(device.getStateSlot());
+}
+
+bool DeviceRegistry::remove(int deviceId) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    if (deviceId >= 0 && deviceId < DENSE_LIMIT) {
+        if (static_cast<size_t>(deviceId) >= dense.size()) return false;
+        Entry& e = dense[static_cast<size_t>(deviceId)];
+        if (!e.device) return false;
+        detachSlot(*e.device);
+        e = Entry();
+    } else {
+        auto it = sparse.find(deviceId);
+        if (it == sparse.end()) return false;
+        detachSlot(*it->second.device);
+        sparse.erase(it);
+    }
+    count--;
+    generation.fetch_add(1, std::memory_order_acq_rel);
+    return true;
+}
+
+std::shared_ptr<Device> DeviceRegistry::find(int deviceId) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    const Entry* e = findEntry(deviceId);
+    return e ? e->device : nullptr;
+}
+
+std::shared_ptr<Room> DeviceRegistry::findRoom(int deviceId) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    const Entry* e = findEntry(deviceId);
+    return e ? e->room.lock() : nullptr;
+}
+
+std::shared_ptr<Device> DeviceRegistry::find(int deviceId, std::shared_ptr<Room>& room) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    const Entry* e = findEntry(deviceId);
+    if (!e) {
+        room.reset();
+        return nullptr;
+    }
+    room = e->room.lock();
+    return e->device;
+}
+
+void DeviceRegistry::setStates(const DeviceCommand* commands, size_t count, BulkResult& result,
+                               ChangeSource source) const {
+    result.reset(count);
+    std::vector<BulkItem> items;
+    items.reserve(count);
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        for (size_t i = 0; i < count; ++i) {
+            const Entry* e = findEntry(commands[i].deviceId);
+            if (!e) continue;
+            result.markFound(i);
+            if (!isValidState(e->device->getType(), commands[i].state)) {
+                result.markRejected(i);
+                continue;
+            }
+            items.push_back({e->room.lock(), e->device, static_cast<uint32_t>(i)});
+        }
+    }
+
+    // group by room (counting sort on first-seen order, stable, so commands for
+    // the same device keep their relative order)
+    std::unordered_map<const Room*, uint32_t> groupOf;
+    std::vector<uint32_t> groupOfItem(items.size());
+    std::vector<size_t> groupStart;
+    const Room* lastRoom = nullptr;
+    uint32_t lastGroup = 0;
+    for (size_t i = 0; i < items.size(); ++i) {
+        const Room* room = items[i].room.get();
+        if (i == 0 || room != lastRoom) { // runs of one room need no hashing
+            auto ins = groupOf.emplace(room, static_cast<uint32_t>(groupStart.size()));
+            if (ins.second) groupStart.push_back(0);
+            lastRoom = room;
+            lastGroup = ins.first->second;
+        }
+        groupOfItem[i] = lastGroup;
+        ++groupStart[lastGroup];
+    }
+    if (groupStart.size() > 1) {
+        size_t offset = 0;
+        for (size_t& g : groupStart) {
+            size_t n = g;
+            g = offset;
+            offset += n;
+        }
+        std::vector<BulkItem> grouped(items.size());
+        for (size_t i = 0; i < items.size(); ++i)
+            grouped[groupStart[groupOfItem[i]]++] = std::move(items[i]);
+        items.swap(grouped);
+    }
+
+    size_t begin = 0;
+    while (begin < items.size()) {
+        size_t end = begin + 1;
+        while (end < items.size() && items[end].room == items[begin].room) ++end;
+        if (items[begin].room) {
+            items[begin].room->applyCommands(commands, &items[begin], end - begin, result, source);
+        } else {
+            // device whose room is already gone: nothing to lock
+            for (size_t i = begin; i < end; ++i) {
+                if (items[i].device->apply(commands[items[i].index].state, source))
+                    result.markChanged(items[i].index);
+            }
+        }
+        begin = end;
+    }
+}
+
+BulkResult DeviceRegistry::setStates(const std::vector<DeviceCommand>& commands, ChangeSource source) const {
+    BulkResult result;
+    setStates(commands.data(), commands.size(), result, source);
+    return result;
+}
+
+size_t DeviceRegistry::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return count;
+}
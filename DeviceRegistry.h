@@ -0,0 +1,116 @@
+#ifndef DEVICEREGISTRY_H
+#define DEVICEREGISTRY_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <shared_mutex>
+#include "Device.h"
+#include "DeviceStateTable.h"
+#include "ChangeBus.h"
+
+class Room;
+
+// One entry of a bulk state change
+struct DeviceCommand {
+    int deviceId;
+    DeviceState state;
+};
+
+// Outcome of a bulk operation: one bit per command index
+struct BulkResult {
+    std::vector<uint64_t> found;    // the id was registered
+    std::vector<uint64_t> rejected; // found, but the state is not one of the device type's; not written
+    std::vector<uint64_t> changed;  // the device's state actually changed
+    size_t foundCount = 0;
+    size_t rejectedCount = 0;
+    size_t changedCount = 0;
+
+    void reset(size_t commands) {
+        found.assign((commands + 63) / 64, 0);
+        rejected.assign((commands + 63) / 64, 0);
+        changed.assign((commands + 63) / 64, 0);
+        foundCount = rejectedCount = changedCount = 0;
+    }
+    bool wasFound(size_t i) const { return (found[i / 64] >> (i % 64)) & 1u; }
+    bool wasRejected(size_t i) const { return (rejected[i / 64] >> (i % 64)) & 1u; }
+    bool wasChanged(size_t i) const { return (changed[i / 64] >> (i % 64)) & 1u; }
+    void markFound(size_t i) { found[i / 64] |= uint64_t(1) << (i % 64); ++foundCount; }
+    void markRejected(size_t i) { rejected[i / 64] |= uint64_t(1) << (i % 64); ++rejectedCount; }
+    void markChanged(size_t i) { changed[i / 64] |= uint64_t(1) << (i % 64); ++changedCount; }
+};
+
+// A resolved command, handed to the owning room by DeviceRegistry::setStates
+struct BulkItem {
+    std::shared_ptr<Room> room;
+    std::shared_ptr<Device> device;
+    uint32_t index; // position in the command list
+};
+
+// Home-wide index of devices by id. Device ids are SQLite rowids and therefore
+// mostly dense, so they index a flat table directly; ids outside the dense range
+// spill into a hash map. Each entry also remembers the room that owns the device.
+// Registered devices keep their state in the registry's DeviceStateTable and
+// publish their changes on the registry's ChangeBus. A removed device keeps its
+// table slot, so it can go on being used (and be added again) without rebinding.
+class DeviceRegistry {
+public:
+    static const int DENSE_LIMIT = 1 << 20;
+
+private:
+    struct Entry {
+        std::shared_ptr<Device> device;
+        std::weak_ptr<Room> room;
+    };
+
+    std::vector<Entry> dense;
+    std::unordered_map<int, Entry> sparse;
+    size_t count = 0;
+    std::atomic<uint64_t> generation{0}; // bumped whenever membership changes
+    ChangeBus bus;
+    DeviceStateTable table;
+    mutable std::shared_mutex mutex;
+
+    const Entry* findEntry(int deviceId) const;
+    void detachSlot(Device& device);
+
+public:
+    DeviceRegistry();
+
+    // returns false if another device is already registered under the same id, or
+    // if the device's state is bound to another registry's table
+    bool add(const std::shared_ptr<Device>& device, const std::shared_ptr<Room>& room);
+    bool remove(int deviceId);
+
+    std::shared_ptr<Device> find(int deviceId) const;
+    std::shared_ptr<Room> findRoom(int deviceId) const;
+    // device and owner in one lookup; room is cleared when the device is unknown
+    std::shared_ptr<Device> find(int deviceId, std::shared_ptr<Room>& room) const;
+
+    size_t size() const;
+    // changes whenever a device is added, removed or moved to another room;
+    // lets callers cache resolved devices (e.g. scene plans) and notice staleness
+    uint64_t getGeneration() const { return generation.load(std::memory_order_acquire); }
+
+    // Apply many state changes at once. Commands are resolved under one registry
+    // lock, grouped by owning room and applied under each room's lock once.
+    // A state that is not valid for the device's type is rejected, not written.
+    void setStates(const DeviceCommand* commands, size_t count, BulkResult& result,
+                   ChangeSource source = ChangeSource::MANUAL) const;
+    BulkResult setStates(const std::vector<DeviceCommand>& commands,
+                         ChangeSource source = ChangeSource::MANUAL) const;
+
+    // house-wide counters, maintained incrementally by the state table
+    int countDevices(DeviceType type, DeviceState state) const { return table.count(type, state); }
+    int activeDeviceCount() const { return table.activeCount(); }
+
+    // columnar state of all registered devices, for bulk operations
+    DeviceStateTable& stateTable() { return table; }
+    const DeviceStateTable& stateTable() const { return table; }
+
+    // change notifications for every registered device
+    ChangeBus& changeBus() { return bus; }
+};
+
+#endif // DEVICEREGISTRY_H
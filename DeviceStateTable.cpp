@@ -0,0 +1,251 @@
+#include "DeviceStateTable.h"
+#include <mutex>
+
+DeviceStateTable::~DeviceStateTable() {
+    for (const auto& chunk : chunks) {
+        for (int i = 0; i < CHUNK_SIZE; ++i) {
+            if (chunk->owners[i]) chunk->owners[i]->unbindStateSlot();
+        }
+    }
+}
+
+int DeviceStateTable::allocate(Device* owner, int deviceId, DeviceType type, int roomId, DeviceState initial) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    int slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        slot = slotCount++;
+        if (static_cast<size_t>(slot / CHUNK_SIZE) >= chunks.size()) {
+            auto chunk = std::make_unique<Chunk>();
+            for (int i = 0; i < CHUNK_SIZE; ++i) {
+                chunk->states[i].store(packStateWord(DeviceState::OFF, 0), std::memory_order_relaxed);
+                for (int a = 0; a < MAX_DEVICE_ATTRIBUTES; ++a)
+                    chunk->attrs[i][a].store(0, std::memory_order_relaxed);
+                chunk->types[i] = FREE_SLOT;
+                chunk->roomIds[i] = -1;
+                chunk->deviceIds[i] = -1;
+                chunk->counters[i].store(nullptr, std::memory_order_relaxed);
+                chunk->owners[i] = nullptr;
+                chunk->attached[i] = false;
+            }
+            chunks.push_back(std::move(chunk));
+        }
+    }
+
+    Chunk& c = chunkOf(slot);
+    int i = slot % CHUNK_SIZE;
+    for (int a = 0; a < MAX_DEVICE_ATTRIBUTES; ++a)
+        c.attrs[i][a].store(attributeSpec(type, a).initial, std::memory_order_relaxed);
+    c.states[i].store(packStateWord(initial, 0), std::memory_order_release);
+    c.types[i] = static_cast<uint8_t>(type);
+    c.roomIds[i] = roomId;
+    c.deviceIds[i] = deviceId;
+    c.owners[i] = owner;
+    c.attached[i] = true;
+    StateCounters* rc = countersForRoom(roomId);
+    c.counters[i].store(rc, std::memory_order_release);
+    adjustCounts(rc, type, initial, +1);
+    return slot;
+}
+
+DeviceStateTable::StateCounters* DeviceStateTable::countersForRoom(int roomId) {
+    auto& rc = roomCounters[roomId];
+    if (!rc) rc = std::make_unique<StateCounters>();
+    return rc.get();
+}
+
+const DeviceStateTable::StateCounters* DeviceStateTable::findRoomCounters(int roomId) const {
+    if (roomId < 0) return &houseCounters;
+    auto it = roomCounters.find(roomId);
+    return it == roomCounters.end() ? nullptr : it->second.get();
+}
+
+void DeviceStateTable::adjustCounts(StateCounters* room, DeviceType type, DeviceState s, int delta) {
+    if (!room) return; // detached: not counted anywhere
+    int t = static_cast<int>(type);
+    int st = static_cast<int>(s);
+    houseCounters.counts[t][st].fetch_add(delta, std::memory_order_relaxed);
+    room->counts[t][st].fetch_add(delta, std::memory_order_relaxed);
+}
+
+void DeviceStateTable::recordStateChange(int slot, int deviceId, DeviceType type, DeviceState oldState,
+                                         uint32_t newWord, ChangeSource source) {
+    StateCounters* rc = chunkOf(slot).counters[slot % CHUNK_SIZE].load(std::memory_order_acquire);
+    adjustCounts(rc, type, oldState, -1);
+    adjustCounts(rc, type, wordState(newWord), +1);
+    if (changeBus) {
+        changeBus->publish({deviceId, oldState, wordState(newWord), source, wordVersion(newWord),
+                            DeviceAttribute::NONE, 0, 0});
+    }
+}
+
+void DeviceStateTable::recordAttributeChange(int deviceId, uint32_t word, DeviceAttribute attribute,
+                                             int32_t oldValue, int32_t newValue, ChangeSource source) {
+    if (changeBus) {
+        changeBus->publish({deviceId, wordState(word), wordState(word), source, wordVersion(word),
+                            attribute, oldValue, newValue});
+    }
+}
+
+int DeviceStateTable::count(DeviceType type, DeviceState s, int roomId) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    const StateCounters* rc = findRoomCounters(roomId);
+    if (!rc) return 0;
+    return rc->counts[static_cast<int>(type)][static_cast<int>(s)].load(std::memory_order_relaxed);
+}
+
+int DeviceStateTable::activeCount(int roomId) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    const StateCounters* rc = findRoomCounters(roomId);
+    if (!rc) return 0;
+    int n = 0;
+    for (int t = 0; t < DEVICE_TYPE_COUNT; ++t) {
+        int on = static_cast<int>(deviceTraits(static_cast<DeviceType>(t)).onState);
+        n += rc->counts[t][on].load(std::memory_order_relaxed);
+    }
+    return n;
+}
+
+int DeviceStateTable::deviceCount(int roomId) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    const StateCounters* rc = findRoomCounters(roomId);
+    if (!rc) return 0;
+    int n = 0;
+    for (const auto& row : rc->counts)
+        for (const auto& c : row) n += c.load(std::memory_order_relaxed);
+    return n;
+}
+
+void DeviceStateTable::release(int slot) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    Chunk& c = chunkOf(slot);
+    int i = slot % CHUNK_SIZE;
+    adjustCounts(c.counters[i].load(std::memory_order_acquire), static_cast<DeviceType>(c.types[i]),
+                 wordState(c.states[i].load(std::memory_order_acquire)), -1);
+    c.counters[i].store(nullptr, std::memory_order_release);
+    c.types[i] = FREE_SLOT;
+    c.roomIds[i] = -1;
+    c.deviceIds[i] = -1;
+    c.owners[i] = nullptr;
+    c.attached[i] = false;
+    freeSlots.push_back(slot);
+}
+
+void DeviceStateTable::detach(int slot) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    Chunk& c = chunkOf(slot);
+    int i = slot % CHUNK_SIZE;
+    if (!c.attached[i]) return;
+    adjustCounts(c.counters[i].load(std::memory_order_acquire), static_cast<DeviceType>(c.types[i]),
+                 wordState(c.states[i].load(std::memory_order_acquire)), -1);
+    c.counters[i].store(nullptr, std::memory_order_release);
+    c.roomIds[i] = -1;
+    c.attached[i] = false;
+}
+
+void DeviceStateTable::setRoom(int slot, int roomId) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    Chunk& c = chunkOf(slot);
+    int i = slot % CHUNK_SIZE;
+    DeviceType type = static_cast<DeviceType>(c.types[i]);
+    if (!c.attached[i]) {
+        StateCounters* rc = countersForRoom(roomId);
+        c.counters[i].store(rc, std::memory_order_release);
+        c.roomIds[i] = roomId;
+        c.attached[i] = true;
+        adjustCounts(rc, type, wordState(c.states[i].load(std::memory_order_acquire)), +1);
+        return;
+    }
+    if (c.roomIds[i] == roomId) return;
+    // move the device's contribution from the old room's counters to the new one
+    DeviceState s = wordState(c.states[i].load(std::memory_order_acquire));
+    StateCounters* oldRoom = c.counters[i].load(std::memory_order_acquire);
+    StateCounters* newRoom = countersForRoom(roomId);
+    if (oldRoom) oldRoom->counts[static_cast<int>(type)][static_cast<int>(s)].fetch_sub(1, std::memory_order_relaxed);
+    newRoom->counts[static_cast<int>(type)][static_cast<int>(s)].fetch_add(1, std::memory_order_relaxed);
+    c.roomIds[i] = roomId;
+    c.counters[i].store(newRoom, std::memory_order_release);
+}
+
+int DeviceStateTable::getRoom(int slot) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return chunkOf(slot).roomIds[slot % CHUNK_SIZE];
+}
+
+int DeviceStateTable::capacity() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return slotCount;
+}
+
+int DeviceStateTable::setStateWhere(int roomId, DeviceType type, DeviceState newState, ChangeSource source) {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    const uint8_t t = static_cast<uint8_t>(type);
+    int changed = 0;
+    for (const auto& chunk : chunks) {
+        Chunk& c = *chunk;
+        for (int i = 0; i < CHUNK_SIZE; ++i) {
+            if (c.types[i] != t || !c.attached[i] || (roomId >= 0 && c.roomIds[i] != roomId)) continue;
+            uint32_t cur = c.states[i].load(std::memory_order_acquire);
+            while (wordState(cur) != newState) {
+                uint32_t next = packStateWord(newState, wordVersion(cur) + 1);
+                if (c.states[i].compare_exchange_weak(cur, next, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                    recordStateChange(static_cast<int>(&chunk - chunks.data()) * CHUNK_SIZE + i,
+                                      c.deviceIds[i], type, wordState(cur), next, source);
+                    ++changed;
+                    break;
+                }
+            }
+        }
+    }
+    return changed;
+}
+
+int DeviceStateTable::countState(DeviceState s, int roomId) const {
+    int n = 0;
+    for (int t = 0; t < DEVICE_TYPE_COUNT; ++t) n += count(static_cast<DeviceType>(t), s, roomId);
+    return n;
+}
+
+std::vector<uint64_t> DeviceStateTable::diff(const std::vector<uint8_t>& target) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    std::vector<uint64_t> bits((static_cast<size_t>(slotCount) + 63) / 64, 0);
+    size_t limit = target.size() < static_cast<size_t>(slotCount) ? target.size() : static_cast<size_t>(slotCount);
+    for (size_t base = 0; base < limit; base += 64) {
+        const Chunk& c = chunkOf(static_cast<int>(base));
+        size_t off = base % CHUNK_SIZE; // CHUNK_SIZE is a multiple of 64
+        size_t n = limit - base < 64 ? limit - base : 64;
+        uint64_t word = 0;
+        for (size_t i = 0; i < n; ++i) {
+            uint8_t want = target[base + i];
+            bool differs = want != FREE_SLOT && c.types[off + i] != FREE_SLOT && c.attached[off + i] &&
+                           static_cast<uint8_t>(c.states[off + i].load(std::memory_order_relaxed)) != want;
+            word |= static_cast<uint64_t>(differs) << i;
+        }
+        bits[base / 64] = word;
+    }
+    return bits;
+}
+
+void DeviceStateTable::snapshot(std::vector<DeviceChangeEvent>& out) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    for (const auto& chunk : chunks) {
+        const Chunk& c = *chunk;
+        for (int i = 0; i < CHUNK_SIZE; ++i) {
+            if (c.types[i] == FREE_SLOT || !c.attached[i]) continue;
+            uint32_t word = c.states[i].load(std::memory_order_acquire);
+            out.push_back({c.deviceIds[i], wordState(word), wordState(word), ChangeSource::SYSTEM,
+                           wordVersion(word), DeviceAttribute::NONE, 0, 0});
+            // and one per attribute, so a resynced subscriber gets current values too
+            DeviceType type = static_cast<DeviceType>(c.types[i]);
+            for (int a = 0; a < MAX_DEVICE_ATTRIBUTES; ++a) {
+                DeviceAttribute attribute = attributeSpec(type, a).attribute;
+                if (attribute == DeviceAttribute::NONE) continue;
+                int32_t value = c.attrs[i][a].load(std::memory_order_acquire);
+                out.push_back({c.deviceIds[i], wordState(word), wordState(word), ChangeSource::SYSTEM,
+                               wordVersion(word), attribute, value, value});
+            }
+        }
+    }
+}
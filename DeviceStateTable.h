@@ -0,0 +1,113 @@
+#ifndef DEVICESTATETABLE_H
+#define DEVICESTATETABLE_H
+
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <shared_mutex>
+#include "Device.h"
+#include "ChangeBus.h"
+
+// Columnar store for the state of every registered device.
+// Rows ("slots") live in fixed-size chunks so a slot never moves once allocated;
+// Device objects keep a pointer to their atomic state word (see Device.h) and
+// read/write it directly. A device keeps its slot for as long as it lives, also
+// while it is removed from the registry (the slot is then detached: not counted,
+// not in snapshots), so a device in use is never rebound.
+// Within a chunk each column is a contiguous array, so house-wide operations run
+// as tight loops over bytes instead of chasing Device pointers.
+// Every state change of a registered device is reported back to the table, which
+// keeps per-room and house-wide counters by type and state and feeds the ChangeBus.
+class DeviceStateTable {
+public:
+    static const int CHUNK_SIZE = 4096;
+    static const uint8_t FREE_SLOT = 0xFF; // type byte of an unused slot
+
+    // number of devices per (type, state), for one room or the whole house
+    struct StateCounters {
+        std::atomic<int> counts[DEVICE_TYPE_COUNT][DEVICE_STATE_COUNT];
+        StateCounters() {
+            for (auto& row : counts)
+                for (auto& c : row) c.store(0, std::memory_order_relaxed);
+        }
+    };
+
+private:
+    struct Chunk {
+        std::atomic<uint32_t> states[CHUNK_SIZE];
+        std::atomic<int32_t> attrs[CHUNK_SIZE][MAX_DEVICE_ATTRIBUTES]; // meaning depends on the type
+        uint8_t types[CHUNK_SIZE];
+        int roomIds[CHUNK_SIZE];
+        int deviceIds[CHUNK_SIZE];
+        std::atomic<StateCounters*> counters[CHUNK_SIZE]; // counters of the owning room, null if detached
+        Device* owners[CHUNK_SIZE];
+        bool attached[CHUNK_SIZE]; // registered; detached slots still belong to their device
+    };
+
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    std::vector<int> freeSlots;
+    int slotCount = 0; // slots handed out so far, including freed ones
+    // guards the chunk list and slot allocation; state changes hold it shared
+    // across the CAS and the counter update, room moves hold it exclusively
+    mutable std::shared_mutex mutex;
+    ChangeBus* changeBus = nullptr;
+    StateCounters houseCounters;
+    std::unordered_map<int, std::unique_ptr<StateCounters>> roomCounters; // by room id, never erased
+
+    Chunk& chunkOf(int slot) const { return *chunks[static_cast<size_t>(slot / CHUNK_SIZE)]; }
+    StateCounters* countersForRoom(int roomId); // caller holds the lock exclusively
+    const StateCounters* findRoomCounters(int roomId) const; // caller holds the lock
+    void adjustCounts(StateCounters* room, DeviceType type, DeviceState s, int delta);
+
+public:
+    DeviceStateTable() = default;
+    ~DeviceStateTable(); // hands state back to devices that outlive the table
+    DeviceStateTable(const DeviceStateTable&) = delete;
+    DeviceStateTable& operator=(const DeviceStateTable&) = delete;
+
+    void setChangeBus(ChangeBus* bus) { changeBus = bus; }
+
+    int allocate(Device* owner, int deviceId, DeviceType type, int roomId, DeviceState initial);
+    void release(int slot); // the owning device is going away
+    // take a slot out of the counters when its device is unregistered (setRoom puts it back)
+    void detach(int slot);
+
+    // stable address of a slot's state word
+    std::atomic<uint32_t>* stateRef(int slot) const { return &chunkOf(slot).states[slot % CHUNK_SIZE]; }
+    std::atomic<int32_t>* attributesRef(int slot) const { return chunkOf(slot).attrs[slot % CHUNK_SIZE]; }
+    void setRoom(int slot, int roomId); // also re-attaches a detached slot
+    int getRoom(int slot) const;
+    int capacity() const;
+
+    // Held by a Device across its state CAS and recordStateChange
+    std::shared_lock<std::shared_mutex> changeLock() const { return std::shared_lock<std::shared_mutex>(mutex); }
+    // Called by Device after it changed its state word (under changeLock) / an attribute
+    void recordStateChange(int slot, int deviceId, DeviceType type, DeviceState oldState,
+                           uint32_t newWord, ChangeSource source);
+    void recordAttributeChange(int deviceId, uint32_t word, DeviceAttribute attribute,
+                               int32_t oldValue, int32_t newValue, ChangeSource source);
+
+    // ----- incrementally maintained counters, O(1) -----
+    // roomId < 0 = whole house
+    int count(DeviceType type, DeviceState s, int roomId = -1) const;
+    // devices in their type's "on" state (ON, or ACTIVE for sensors)
+    int activeCount(int roomId = -1) const;
+    int deviceCount(int roomId = -1) const;
+
+    // ----- bulk operations -----
+    // set every device of a type in a room (roomId < 0 = whole house); returns how many changed
+    int setStateWhere(int roomId, DeviceType type, DeviceState newState,
+                      ChangeSource source = ChangeSource::SYSTEM);
+    // devices currently in a state, optionally restricted to a room (roomId < 0 = whole house)
+    int countState(DeviceState s, int roomId = -1) const;
+    int countState(DeviceType type, DeviceState s, int roomId = -1) const { return count(type, s, roomId); }
+    // target is indexed by slot (FREE_SLOT = don't care); returns a bitset, one bit per slot,
+    // set where the current state differs from the target
+    std::vector<uint64_t> diff(const std::vector<uint8_t>& target) const;
+    // current state and attribute values of every device as no-op change events (for bus resync)
+    void snapshot(std::vector<DeviceChangeEvent>& out) const;
+};
+
+#endif // DEVICESTATETABLE_H
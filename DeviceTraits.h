@@ -0,0 +1,144 @@
+#ifndef DEVICETRAITS_H
+#define DEVICETRAITS_H
+
+#include <cstdint>
+#include <string_view>
+
+enum class DeviceType {
+    LIGHT,
+    FAN,
+    AC,
+    SENSOR
+};
+
+enum class DeviceState : uint8_t {
+    OFF,
+    ON,
+    ACTIVE,  // For sensors or special states
+    INACTIVE
+};
+
+// Numeric attributes a device type can carry next to its on/off state
+enum class DeviceAttribute : uint8_t {
+    NONE,
+    BRIGHTNESS, // LIGHT, percent 0-100
+    FAN_SPEED,  // FAN 0-5, AC fan 1-3
+    SETPOINT,   // AC, tenths of a degree Celsius
+    READING     // SENSOR, hundredths of the measured unit
+};
+
+// Each device type has at most MAX_DEVICE_ATTRIBUTES attributes, stored by index
+constexpr int MAX_DEVICE_ATTRIBUTES = 2;
+constexpr int DEVICE_TYPE_COUNT = 4;
+constexpr int DEVICE_STATE_COUNT = 4;
+
+struct AttributeSpec {
+    DeviceAttribute attribute; // NONE for an unused index
+    int32_t minValue;
+    int32_t maxValue;
+    int32_t initial;
+    const char* label;
+};
+
+// Compile-time description of a device type: which states it uses, how toggle
+// moves between them, and its attribute layout. Hot paths dispatch through this
+// table instead of the virtual Device interface.
+struct DeviceTypeTraits {
+    DeviceState onState;
+    DeviceState offState;
+    AttributeSpec attributes[MAX_DEVICE_ATTRIBUTES];
+};
+
+constexpr AttributeSpec NO_ATTRIBUTE = {DeviceAttribute::NONE, 0, 0, 0, ""};
+
+constexpr DeviceTypeTraits DEVICE_TRAITS[DEVICE_TYPE_COUNT] = {
+    // LIGHT
+    {DeviceState::ON, DeviceState::OFF,
+     {{DeviceAttribute::BRIGHTNESS, 0, 100, 100, "Brightness (0-100)"}, NO_ATTRIBUTE}},
+    // FAN
+    {DeviceState::ON, DeviceState::OFF,
+     {{DeviceAttribute::FAN_SPEED, 0, 5, 3, "Fan speed (0-5)"}, NO_ATTRIBUTE}},
+    // AC
+    {DeviceState::ON, DeviceState::OFF,
+     {{DeviceAttribute::SETPOINT, 160, 300, 240, "Setpoint (0.1 C, 160-300)"},
+      {DeviceAttribute::FAN_SPEED, 1, 3, 2, "Fan speed (1-3)"}}},
+    // SENSOR
+    {DeviceState::ACTIVE, DeviceState::INACTIVE,
+     {{DeviceAttribute::READING, -1000000, 1000000, 0, "Reading (x0.01)"}, NO_ATTRIBUTE}},
+};
+
+constexpr std::string_view DEVICE_STATE_NAMES[DEVICE_STATE_COUNT] = {"OFF", "ON", "ACTIVE", "INACTIVE"};
+
+constexpr const DeviceTypeTraits& deviceTraits(DeviceType type) {
+    return DEVICE_TRAITS[static_cast<int>(type)];
+}
+
+constexpr std::string_view stateName(DeviceState s) {
+    return static_cast<int>(s) < DEVICE_STATE_COUNT ? DEVICE_STATE_NAMES[static_cast<int>(s)]
+                                                    : std::string_view("UNKNOWN");
+}
+
+constexpr bool isValidState(DeviceType type, DeviceState s) {
+    return s == deviceTraits(type).onState || s == deviceTraits(type).offState;
+}
+
+// toggle goes to offState from onState and to onState from anything else
+constexpr DeviceState toggledState(DeviceType type, DeviceState current) {
+    return current == deviceTraits(type).onState ? deviceTraits(type).offState : deviceTraits(type).onState;
+}
+
+// attribute layout of a device type by index, and the reverse lookup (-1 if unsupported)
+constexpr const AttributeSpec& attributeSpec(DeviceType type, int index) {
+    return (static_cast<int>(type) < 0 || static_cast<int>(type) >= DEVICE_TYPE_COUNT ||
+            index < 0 || index >= MAX_DEVICE_ATTRIBUTES)
+               ? NO_ATTRIBUTE
+               : deviceTraits(type).attributes[index];
+}
+
+constexpr int attributeIndex(DeviceType type, DeviceAttribute attribute) {
+    for (int i = 0; i < MAX_DEVICE_ATTRIBUTES; ++i) {
+        if (attribute != DeviceAttribute::NONE && attributeSpec(type, i).attribute == attribute) return i;
+    }
+    return -1;
+}
+
+// case-insensitive comparison against an (upper case) state name
+constexpr bool matchesStateName(DeviceState s, std::string_view text) {
+    std::string_view name = stateName(s);
+    if (name.size() != text.size()) return false;
+    for (size_t i = 0; i < name.size(); ++i) {
+        char c = text[i];
+        if (c >= 'a' && c <= 'z') c = static_cast<char>(c - 'a' + 'A');
+        if (c != name[i]) return false;
+    }
+    return true;
+}
+
+// case-insensitive parse of one of the type's two state names ("on", "INACTIVE", ...)
+constexpr bool parseStateName(DeviceType type, std::string_view text, DeviceState& out) {
+    const DeviceState candidates[2] = {deviceTraits(type).onState, deviceTraits(type).offState};
+    for (DeviceState s : candidates) {
+        if (matchesStateName(s, text)) {
+            out = s;
+            return true;
+        }
+    }
+    return false;
+}
+
+// same, accepting any state name (when the device type is not known)
+constexpr bool parseStateName(std::string_view text, DeviceState& out) {
+    for (int i = 0; i < DEVICE_STATE_COUNT; ++i) {
+        if (matchesStateName(static_cast<DeviceState>(i), text)) {
+            out = static_cast<DeviceState>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+static_assert(toggledState(DeviceType::LIGHT, DeviceState::ON) == DeviceState::OFF, "light toggle");
+static_assert(toggledState(DeviceType::SENSOR, DeviceState::INACTIVE) == DeviceState::ACTIVE, "sensor toggle");
+static_assert(attributeIndex(DeviceType::AC, DeviceAttribute::FAN_SPEED) == 1, "AC attribute layout");
+
+#endif // DEVICETRAITS_H
@@ -0,0 +1,83 @@
+#include "HomeArena.h"
+#include "Device.h"
+#include "Room.h"
+#include <cstring>
+
+const char* NamePool::store(std::string_view s) {
+    size_t need = s.size() + 1; // keep names NUL-terminated for C APIs
+    char* dst;
+    if (need > BLOCK_SIZE / 4) {
+        // oversized names get a block of their own; the next name starts a fresh block
+        blocks.emplace_back(new char[need]);
+        reserved += need;
+        blockUsed = BLOCK_SIZE;
+        dst = blocks.back().get();
+    } else {
+        if (blockUsed + need > BLOCK_SIZE) {
+            blocks.emplace_back(new char[BLOCK_SIZE]);
+            reserved += BLOCK_SIZE;
+            blockUsed = 0;
+        }
+        dst = blocks.back().get() + blockUsed;
+        blockUsed += need;
+    }
+    std::memcpy(dst, s.data(), s.size());
+    dst[s.size()] = '\0';
+    return dst;
+}
+
+std::string_view NamePool::intern(std::string_view s) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = names.find(s);
+    if (it != names.end()) return *it;
+    std::string_view stored(store(s), s.size());
+    names.insert(stored);
+    return stored;
+}
+
+size_t NamePool::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return names.size();
+}
+
+size_t NamePool::bytesReserved() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return reserved;
+}
+
+NamePool& NamePool::shared() {
+    static NamePool pool;
+    return pool;
+}
+
+void* HomeArena::allocate(size_t bytes, size_t alignment) {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t offset = (blockUsed + alignment - 1) & ~(alignment - 1);
+    if (blocks.empty() || offset + bytes > BLOCK_SIZE) {
+        size_t size = bytes > BLOCK_SIZE ? bytes : BLOCK_SIZE;
+        blocks.emplace_back(new unsigned char[size]);
+        reserved += size;
+        offset = 0;
+    }
+    blockUsed = offset + bytes;
+    used += bytes;
+    return blocks.back().get() + offset;
+}
+
+std::shared_ptr<Device> HomeArena::makeDevice(int id, std::string_view name, DeviceType type) {
+    return std::allocate_shared<Device>(ArenaAllocator<Device>(shared_from_this()), id, name, type, &names);
+}
+
+std::shared_ptr<Room> HomeArena::makeRoom(int id, std::string_view name) {
+    return std::allocate_shared<Room>(ArenaAllocator<Room>(shared_from_this()), id, name, &names);
+}
+
+size_t HomeArena::bytesUsed() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return used;
+}
+
+size_t HomeArena::bytesReserved() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return reserved;
+}
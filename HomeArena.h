@@ -0,0 +1,94 @@
+#ifndef HOMEARENA_H
+#define HOMEARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+class Device;
+class Room;
+enum class DeviceType;
+
+// Interned names: every distinct string is stored once and handed out as a
+// string_view that stays valid for the pool's lifetime.
+class NamePool {
+private:
+    static const size_t BLOCK_SIZE = 16 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t blockUsed = BLOCK_SIZE;
+    size_t reserved = 0;
+    std::unordered_set<std::string_view> names;
+    mutable std::mutex mutex;
+
+    const char* store(std::string_view s);
+
+public:
+    NamePool() = default;
+    NamePool(const NamePool&) = delete;
+    NamePool& operator=(const NamePool&) = delete;
+
+    std::string_view intern(std::string_view s);
+    size_t size() const;
+    size_t bytesReserved() const;
+
+    // process-wide pool for objects created outside a HomeArena
+    static NamePool& shared();
+};
+
+// Backing store for one home's model. Rooms and devices (including their
+// shared_ptr control blocks) are bump-allocated from large blocks, so a home's
+// objects sit next to each other instead of being spread over the heap.
+// Memory is only given back when the arena itself goes away; every object made
+// here holds a reference to the arena, so it cannot be freed too early.
+class HomeArena : public std::enable_shared_from_this<HomeArena> {
+private:
+    static const size_t BLOCK_SIZE = 64 * 1024;
+
+    std::vector<std::unique_ptr<unsigned char[]>> blocks;
+    size_t blockUsed = BLOCK_SIZE;
+    size_t used = 0;
+    size_t reserved = 0;
+    NamePool names;
+    mutable std::mutex mutex;
+
+public:
+    // must be owned by a shared_ptr (use std::make_shared<HomeArena>())
+    HomeArena() = default;
+    HomeArena(const HomeArena&) = delete;
+    HomeArena& operator=(const HomeArena&) = delete;
+
+    void* allocate(size_t bytes, size_t alignment);
+
+    std::shared_ptr<Device> makeDevice(int id, std::string_view name, DeviceType type);
+    std::shared_ptr<Room> makeRoom(int id, std::string_view name);
+
+    NamePool& namePool() { return names; }
+    size_t bytesUsed() const;
+    size_t bytesReserved() const;
+};
+
+// Allocator for std::allocate_shared; deallocate is a no-op, see HomeArena
+template <typename T>
+struct ArenaAllocator {
+    using value_type = T;
+
+    std::shared_ptr<HomeArena> arena;
+
+    explicit ArenaAllocator(std::shared_ptr<HomeArena> a) : arena(std::move(a)) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T*, size_t) {}
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+};
+
+#endif // HOMEARENA_H
@@ -0,0 +1,120 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+// Bounded lock-free queues used by the sensor ingestion pipeline.
+// Capacity is rounded up to a power of two so indices wrap with a mask.
+
+inline size_t ringCapacityFor(size_t requested) {
+    size_t cap = 2;
+    while (cap < requested) cap <<= 1;
+    return cap;
+}
+
+// Single producer / single consumer ring
+template <typename T>
+class SpscRing {
+private:
+    const size_t mask;
+    std::unique_ptr<T[]> slots;
+    alignas(64) std::atomic<size_t> head{0}; // next slot to read (consumer)
+    alignas(64) std::atomic<size_t> tail{0}; // next slot to write (producer)
+
+public:
+    explicit SpscRing(size_t capacity)
+        : mask(ringCapacityFor(capacity) - 1), slots(new T[mask + 1]) {}
+
+    size_t capacity() const { return mask + 1; }
+
+    bool tryPush(const T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) > mask) return false; // full
+        slots[t & mask] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& out) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false; // empty
+        out = slots[h & mask];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // pop up to maxItems into out; returns how many were taken
+    size_t popBatch(T* out, size_t maxItems) {
+        size_t h = head.load(std::memory_order_relaxed);
+        size_t available = tail.load(std::memory_order_acquire) - h;
+        size_t n = available < maxItems ? available : maxItems;
+        for (size_t i = 0; i < n; ++i) out[i] = slots[(h + i) & mask];
+        head.store(h + n, std::memory_order_release);
+        return n;
+    }
+
+    size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+};
+
+// Multi producer / single consumer ring (bounded, per-cell sequence numbers)
+template <typename T>
+class MpscRing {
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        T value;
+    };
+
+    const size_t mask;
+    std::unique_ptr<Cell[]> cells;
+    alignas(64) std::atomic<size_t> tail{0}; // producers claim from here
+    alignas(64) size_t head = 0;             // consumer only
+
+public:
+    explicit MpscRing(size_t capacity)
+        : mask(ringCapacityFor(capacity) - 1), cells(new Cell[mask + 1]) {
+        for (size_t i = 0; i <= mask; ++i) cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+    bool tryPush(const T& item) {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos & mask];
+            size_t seq = cell.seq.load(std::memory_order_acquire);
+            if (seq == pos) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = item;
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (seq < pos) {
+                return false; // full
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T& out) {
+        Cell& cell = cells[head & mask];
+        if (cell.seq.load(std::memory_order_acquire) != head + 1) return false; // empty or in flight
+        out = cell.value;
+        cell.seq.store(head + mask + 1, std::memory_order_release);
+        ++head;
+        return true;
+    }
+
+    size_t popBatch(T* out, size_t maxItems) {
+        size_t n = 0;
+        while (n < maxItems && tryPop(out[n])) ++n;
+        return n;
+    }
+};
+
+#endif // RINGBUFFER_H
@@ -1,30 +1,53 @@
 #include "Room.h"
+#include "HomeArena.h"
+#include <iostream>
 
-Room::Room(int id, const std::string& name)
-    : id(id), name(name) {}
+Room::Room(int id, std::string_view name, NamePool* names)
+    : id(id), names(names ? names : &NamePool::shared()) {
+    this->name = this->names->intern(name);
+}
 
-Room::~Room() {}
+Room::~Room() {
+    if (registry) {
+        for (const auto& device : devices) registry->remove(device->getId());
+    }
+}
 
 int Room::getId() const {
     return id;
 }
 
-std::string Room::getName() const {
-    return name;
+void Room::setName(std::string_view newName) {
+    name = names->intern(newName);
 }
 
-void Room::setName(const std::string& newName) {
-    name = newName;
+void Room::attachRegistry(const std::shared_ptr<DeviceRegistry>& reg) {
+    std::unique_lock<std::shared_mutex> lock(devicesMutex);
+    registry = reg;
+    if (!registry) return;
+    auto self = shared_from_this();
+    for (const auto& device : devices) {
+        if (!registry->add(device, self))
+            std::cerr << "Device ID " << device->getId() << " is already registered in another room." << std::endl;
+    }
 }
 
 void Room::addDevice(std::shared_ptr<Device> device) {
+    std::unique_lock<std::shared_mutex> lock(devicesMutex);
+    if (registry && !registry->add(device, shared_from_this())) {
+        std::cerr << "Device ID " << device->getId() << " is already registered in another room." << std::endl;
+        return;
+    }
     devices.push_back(device);
 }
 
 bool Room::removeDevice(int deviceId) {
+    if (registry && !getDeviceById(deviceId)) return false;
+    std::unique_lock<std::shared_mutex> lock(devicesMutex);
     for (auto it = devices.begin(); it != devices.end(); ++it) {
         if ((*it)->getId() == deviceId) {
             devices.erase(it);
+            if (registry) registry->remove(deviceId);
             return true;
         }
     }
@@ -32,10 +55,49 @@ bool Room::removeDevice(int deviceId) {
 }
 
 std::vector<std::shared_ptr<Device>> Room::getDevices() const {
+    std::shared_lock<std::shared_mutex> lock(devicesMutex);
     return devices;
 }
 
+size_t Room::deviceCount() const {
+    std::shared_lock<std::shared_mutex> lock(devicesMutex);
+    return devices.size();
+}
+
+int Room::countDevices(DeviceType type, DeviceState state) const {
+    if (registry) return registry->stateTable().count(type, state, id);
+    int n = 0;
+    forEachDevice([&](const Device& device) {
+        if (device.getType() == type && device.getState() == state) ++n;
+    });
+    return n;
+}
+
+int Room::activeDeviceCount() const {
+    if (registry) return registry->stateTable().activeCount(id);
+    int n = 0;
+    forEachDevice([&](const Device& device) {
+        if (device.getState() == deviceTraits(device.getType()).onState) ++n;
+    });
+    return n;
+}
+
+void Room::applyCommands(const DeviceCommand* commands, const BulkItem* items, size_t count,
+                         BulkResult& result, ChangeSource source) {
+    std::shared_lock<std::shared_mutex> lock(devicesMutex);
+    for (size_t i = 0; i < count; ++i) {
+        if (items[i].device->apply(commands[items[i].index].state, source))
+            result.markChanged(items[i].index);
+    }
+}
+
 std::shared_ptr<Device> Room::getDeviceById(int deviceId) const {
+    if (registry) {
+        std::shared_ptr<Room> owner;
+        auto device = registry->find(deviceId, owner);
+        return owner.get() == this ? device : nullptr;
+    }
+    std::shared_lock<std::shared_mutex> lock(devicesMutex);
     for (const auto& device : devices) {
         if (device->getId() == deviceId) {
             return device;
@@ -45,12 +107,9 @@ std::shared_ptr<Device> Room::getDeviceById(int deviceId) const {
 }
 
 bool Room::toggleDevice(int deviceId) {
-    for (auto& device : devices) {
-        if (device->getId() == deviceId) {
-            device->toggle();
-            return true;
-        }
-    }
-    return false;
+    auto device = getDeviceById(deviceId);
+    if (!device) return false;
+    device->applyToggle();
+    return true;
 }
 
@@ -3,45 +3,81 @@
 
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include "Device.h"
+#include "DeviceRegistry.h"
 
 
-class Room {
+class Room : public std::enable_shared_from_this<Room> {
 private:
     int id;
-    std::string name;
+    std::string_view name;                    // interned in names
+    NamePool* names;
     std::vector<std::shared_ptr<Device>> devices;
+    std::shared_ptr<DeviceRegistry> registry; // home-wide id index, optional
+    mutable std::shared_mutex devicesMutex;   // guards the device list, not device state
 
 
 public:
-    Room(int id, const std::string& name);
+    // names default to the shared pool; HomeArena passes its own
+    Room(int id, std::string_view name, NamePool* names = nullptr);
     ~Room();
 
 
     int getId() const;
-    std::string getName() const;
-    void setName(const std::string& newName);
+    std::string_view getName() const { return name; }
+    void setName(std::string_view newName);
+
+    // Register this room's devices in a home-wide registry; lookups by id then go
+    // through it instead of scanning the device list. The room must be owned by a shared_ptr.
+    void attachRegistry(const std::shared_ptr<DeviceRegistry>& reg);
+    std::shared_ptr<DeviceRegistry> getRegistry() const { return registry; }
 
 
     void addDevice(std::shared_ptr<Device> device);
     bool removeDevice(int deviceId);
     std::vector<std::shared_ptr<Device>> getDevices() const;
 
+    // Visit every device under a read lock without copying the list.
+    // The visitor must not add or remove devices of this room.
+    template <typename Fn>
+    void forEachDevice(Fn&& fn) const {
+        std::shared_lock<std::shared_mutex> lock(devicesMutex);
+        for (const auto& device : devices) {
+            if (device) fn(*device);
+        }
+    }
+    // Run fn while holding the device-list read lock, so membership can't change
+    // meanwhile. fn must not add or remove devices of this room.
+    template <typename Fn>
+    void withDevicesLocked(Fn&& fn) const {
+        std::shared_lock<std::shared_mutex> lock(devicesMutex);
+        fn();
+    }
+    size_t deviceCount() const;
+
+    // devices of a type in a state / devices that are on; O(1) through the registry's
+    // counters when attached, otherwise a scan of the device list
+    int countDevices(DeviceType type, DeviceState state) const;
+    int activeDeviceCount() const;
+
 
     bool toggleDevice(int deviceId);
+
+    // Used by DeviceRegistry::setStates: apply the commands of items (all owned by
+    // this room) while holding the device-list lock once
+    void applyCommands(const DeviceCommand* commands, const BulkItem* items, size_t count,
+                       BulkResult& result, ChangeSource source);
     
     std::shared_ptr<Device> getDeviceById(int deviceId) const;
 
     // ====== New method added below, does not change old code =======
     std::shared_ptr<Device> getSharedDeviceById(int deviceId) const {
-        for (const auto& device : devices) {
-            if (device && device->getId() == deviceId) {
-                return device;
-            }
-        }
-        return nullptr;
+        return getDeviceById(deviceId);
     }
 };
 
@@ -2,57 +2,220 @@
 #include <iostream>
 #include <thread>
 #include <chrono>
+#include <algorithm>
+
+namespace {
+long long steadyNowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+}
 
 void RuleEngine::addRule(const Rule &rule) {
     rules.push_back(rule);
+    ruleRuntime.emplace_back();
+    if (rule.aggregate != SignalAggregate::LATEST && rule.windowSeconds > 0)
+        ruleRuntime.back().windowIndex = windowIndexFor(rule.windowSeconds);
     std::cout << "Rule added successfully for device ID " << rule.deviceId << "\n";
 }
 
+int RuleEngine::registerRoom(const std::string &roomName) {
+    auto it = roomIds.find(roomName);
+    if (it != roomIds.end()) return it->second;
+
+    int id = static_cast<int>(roomNames.size());
+    roomIds.emplace(roomName, id);
+    roomNames.push_back(roomName);
+    signalValues.push_back(25.0f); // default temperature
+    signalValues.push_back(0.0f);  // no motion
+    for (int k = 0; k < static_cast<int>(SignalKind::COUNT); ++k) {
+        signalWindows.emplace_back();
+        for (int len : windowLengths) signalWindows.back().emplace_back(len);
+    }
+    return id;
+}
+
+int RuleEngine::windowIndexFor(int seconds) {
+    for (size_t i = 0; i < windowLengths.size(); ++i) {
+        if (windowLengths[i] == seconds) return static_cast<int>(i);
+    }
+    windowLengths.push_back(seconds);
+    for (auto &windows : signalWindows) windows.emplace_back(seconds);
+    return static_cast<int>(windowLengths.size()) - 1;
+}
+
+void RuleEngine::setSignal(int signal, float value, long long timestampUs) {
+    signalValues[signal] = value;
+    for (auto &w : signalWindows[signal]) w.add(value, timestampUs);
+}
+
+float RuleEngine::getSignalAggregate(int signal, SignalAggregate agg, int windowSeconds) {
+    float out = signalValues[signal];
+    if (agg == SignalAggregate::LATEST || windowSeconds <= 0) return out;
+    signalWindows[signal][static_cast<size_t>(windowIndexFor(windowSeconds))].query(agg, out);
+    return out;
+}
+
+int RuleEngine::findRoom(const std::string &roomName) const {
+    auto it = roomIds.find(roomName);
+    return it == roomIds.end() ? -1 : it->second;
+}
+
 void RuleEngine::setRoomTemperature(const std::string &roomName, float temp) {
-    roomTemperatureMap[roomName] = temp;
+    setSignal(signalId(registerRoom(roomName), SignalKind::TEMPERATURE), temp, steadyNowUs());
     std::cout << "Temperature in " << roomName << " set to " << temp << " Celcius\n";
 }
 
 void RuleEngine::setRoomMotion(const std::string &roomName, bool motionDetected) {
-    roomMotionMap[roomName] = motionDetected;
+    setSignal(signalId(registerRoom(roomName), SignalKind::MOTION), motionDetected ? 1.0f : 0.0f,
+                 steadyNowUs());
     std::cout << "Motion in " << roomName << ": " << (motionDetected ? "Detected" : "Not Detected") << "\n";
 }
 
-float RuleEngine::getRoomTemperature(const std::string &roomName) {
-    if (roomTemperatureMap.find(roomName) != roomTemperatureMap.end())
-        return roomTemperatureMap[roomName];
-    return 25.0f; // default
+void RuleEngine::ingest(const SensorReading *readings, size_t count) {
+    const int signalCount = static_cast<int>(signalValues.size());
+    for (size_t i = 0; i < count; ++i) {
+        const SensorReading &r = readings[i];
+        if (r.signal < 0 || r.signal >= signalCount) continue;
+        setSignal(r.signal, r.value, r.timestampUs);
+    }
+}
+
+float RuleEngine::getRoomTemperature(const std::string &roomName) const {
+    int id = findRoom(roomName);
+    return id < 0 ? 25.0f : getRoomTemperature(id); // default
+}
+
+bool RuleEngine::getRoomMotion(const std::string &roomName) const {
+    int id = findRoom(roomName);
+    return id < 0 ? false : getRoomMotion(id);
+}
+
+float RuleEngine::ruleInput(const Rule &rule, const RuleRuntime &rt, int roomId) const {
+    SignalKind kind = rule.ruleType == "motion" ? SignalKind::MOTION : SignalKind::TEMPERATURE;
+    int signal = signalId(roomId, kind);
+    float value = signalValues[signal];
+    if (rt.windowIndex >= 0)
+        signalWindows[signal][static_cast<size_t>(rt.windowIndex)].query(rule.aggregate, value);
+    return value;
+}
+
+bool RuleEngine::evaluateRule(const Rule &rule, const RuleRuntime &rt, bool deviceOn, float input) const {
+    // motion: any motion in the latest reading (or in the window aggregate) turns the device on
+    if (rule.ruleType == "motion") return input > rule.threshold;
+
+    // inside the band the rule keeps its last output (or the device's state on first pass)
+    bool held = rt.hasOutput ? rt.outputOn : deviceOn;
+    float upper = rule.threshold + rule.hysteresis;
+    float lower = rule.threshold - rule.hysteresis;
+    if (rule.turnOnAbove) {
+        if (input > upper) return true;
+        if (input <= lower) return false;
+    } else {
+        if (input < lower) return true;
+        if (input >= upper) return false;
+    }
+    return held;
 }
 
-bool RuleEngine::getRoomMotion(const std::string &roomName) {
-    if (roomMotionMap.find(roomName) != roomMotionMap.end())
-        return roomMotionMap[roomName];
-    return false;
+bool RuleEngine::outranks(const Proposal &a, const Proposal &b) const {
+    if (a.on != b.on) {
+        if (policy == ConflictPolicy::PREFER_ON) return a.on;
+        if (policy == ConflictPolicy::PREFER_OFF) return !a.on;
+    }
+    int pa = rules[a.ruleIndex].priority;
+    int pb = rules[b.ruleIndex].priority;
+    if (pa != pb) return pa > pb;
+    return a.ruleIndex > b.ruleIndex; // keep the old "last rule wins" behaviour on ties
 }
 
 void RuleEngine::applyRules(const std::shared_ptr<Room> room) {
     if (!room) return;
 
-    std::string roomName = room->getName();
-    float currentTemp = getRoomTemperature(roomName);
-    bool motionDetected = getRoomMotion(roomName);
+    RoomBinding &binding = roomBindings[room->getId()];
+    if (binding.name.data() == nullptr || binding.name != room->getName()) {
+        std::string name(room->getName());
+        int id = registerRoom(name);
+        binding = {roomIds.find(name)->first, id};
+    }
+    int roomId = binding.id;
+    auto now = std::chrono::steady_clock::now();
 
-    for (const auto &rule : rules) {
+    // 1) collect: every rule votes for its device
+    proposals.clear();
+    for (size_t i = 0; i < rules.size(); ++i) {
+        const auto &rule = rules[i];
+        if (rule.ruleType != "temperature" && rule.ruleType != "motion") continue;
         auto device = room->getDeviceById(rule.deviceId);
         if (!device) continue;
 
-        if (rule.ruleType == "temperature") {
-            if (rule.turnOnAbove) {
-                if (currentTemp > rule.threshold) device->turnOn();
-                else device->turnOff();
+        RuleRuntime &rt = ruleRuntime[i];
+        bool deviceOn = device->getState() == deviceTraits(device->getType()).onState;
+        bool wantOn = evaluateRule(rule, rt, deviceOn, ruleInput(rule, rt, roomId));
+        stats.evaluations++;
+
+        if (!rt.hasOutput) {
+            rt.hasOutput = true;
+            rt.outputOn = wantOn;
+            rt.lastTransition = now;
+        } else if (wantOn != rt.outputOn) {
+            if (rule.minDwellSeconds > 0 &&
+                now - rt.lastTransition < std::chrono::seconds(rule.minDwellSeconds)) {
+                stats.dwellHolds++;
             } else {
-                if (currentTemp < rule.threshold) device->turnOn();
-                else device->turnOff();
+                rt.outputOn = wantOn;
+                rt.lastTransition = now;
             }
-        } else if (rule.ruleType == "motion") {
-            if (motionDetected) device->turnOn();
-            else device->turnOff();
         }
+
+        proposals.push_back({rule.deviceId, static_cast<int>(i), rt.outputOn});
+    }
+
+    // 2) resolve: group votes by device and pick one winner per device
+    std::stable_sort(proposals.begin(), proposals.end(),
+                     [](const Proposal &a, const Proposal &b) { return a.deviceId < b.deviceId; });
+
+    lastResolutions.clear();
+    for (size_t begin = 0; begin < proposals.size();) {
+        size_t end = begin + 1;
+        while (end < proposals.size() && proposals[end].deviceId == proposals[begin].deviceId) ++end;
+
+        size_t winner = begin;
+        bool disagree = false;
+        for (size_t j = begin + 1; j < end; ++j) {
+            if (proposals[j].on != proposals[begin].on) disagree = true;
+            if (outranks(proposals[j], proposals[winner])) winner = j;
+        }
+        if (disagree) stats.conflicts++;
+
+        RuleResolution res;
+        res.deviceId = proposals[winner].deviceId;
+        res.winnerRule = proposals[winner].ruleIndex;
+        res.on = proposals[winner].on;
+        res.written = false;
+        for (size_t j = begin; j < end; ++j) {
+            if (j != winner && proposals[j].on != res.on)
+                res.losingRules.push_back(proposals[j].ruleIndex);
+        }
+        lastResolutions.push_back(std::move(res));
+        begin = end;
+    }
+
+    // 3) apply: write only devices whose actual state differs from the resolved output,
+    // so a device switched away by hand or by a scene is corrected on the next pass
+    for (auto &res : lastResolutions) {
+        auto device = room->getDeviceById(res.deviceId);
+        if (!device) continue;
+        const DeviceTypeTraits &traits = deviceTraits(device->getType());
+        DeviceState target = res.on ? traits.onState : traits.offState;
+        if (device->getState() == target) {
+            stats.suppressedWrites++;
+            continue;
+        }
+
+        device->apply(target, ChangeSource::RULE);
+        res.written = true;
+        stats.actuations++;
     }
 }
 
@@ -62,10 +225,45 @@ void RuleEngine::printRules() const {
         std::cout << "  • Device ID: " << r.deviceId << " | Type: " << r.ruleType;
         if (r.ruleType == "temperature")
             std::cout << " | Threshold: " << r.threshold << " Celcius";
+        if (r.aggregate != SignalAggregate::LATEST && r.windowSeconds > 0) {
+            static const char *aggNames[] = {"latest", "mean", "min", "max", "rate"};
+            std::cout << " | Over " << r.windowSeconds << "s: "
+                      << aggNames[static_cast<int>(r.aggregate)];
+        }
+        if (r.hysteresis > 0.0f)
+            std::cout << " | Hysteresis: +/-" << r.hysteresis;
+        if (r.minDwellSeconds > 0)
+            std::cout << " | Min dwell: " << r.minDwellSeconds << "s";
+        if (r.priority != 0)
+            std::cout << " | Priority: " << r.priority;
         std::cout << "\n";
     }
 }
 
+void RuleEngine::printStats() const {
+    std::cout << "\nRule Engine Stats:\n"
+              << "  Evaluations: " << stats.evaluations << "\n"
+              << "  Device writes: " << stats.actuations << "\n"
+              << "  Suppressed writes: " << stats.suppressedWrites << "\n"
+              << "  Held by min dwell: " << stats.dwellHolds << "\n"
+              << "  Conflicts resolved: " << stats.conflicts << "\n";
+}
+
+void RuleEngine::printLastResolution() const {
+    std::cout << "\nLast Rule Resolution:\n";
+    for (const auto &res : lastResolutions) {
+        std::cout << "  • Device ID: " << res.deviceId << " -> " << (res.on ? "ON" : "OFF")
+                  << " | Winner: rule #" << res.winnerRule
+                  << " (" << rules[res.winnerRule].ruleType << ")";
+        if (!res.losingRules.empty()) {
+            std::cout << " | Overruled:";
+            for (int idx : res.losingRules)
+                std::cout << " #" << idx << " (" << rules[idx].ruleType << ")";
+        }
+        std::cout << (res.written ? " | written" : " | unchanged") << "\n";
+    }
+}
+
 void RuleEngine::startMonitoring(const std::shared_ptr<Room>& room) 
 {
     while (true) {
@@ -4,9 +4,12 @@
 #include <memory>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <chrono>
 #include <unordered_map>
 #include "Room.h"
 #include "Device.h"
+#include "SignalWindow.h"
 
 // Base class for a rule
 class Rule {
@@ -15,16 +18,106 @@ public:
     std::string ruleType; // "motion" or "temperature"
     float threshold;
     bool turnOnAbove;
-    Rule(int id, const std::string &type, float th = 0.0f, bool onAbove = true)
-        : deviceId(id), ruleType(type), threshold(th), turnOnAbove(onAbove) {}
+    float hysteresis;     // half-width of the dead band around threshold (temperature rules)
+    int minDwellSeconds;  // minimum time the rule holds an output before switching again
+    int priority;         // higher wins when several rules target the same device
+    SignalAggregate aggregate; // e.g. MEAN over windowSeconds instead of the latest value
+    int windowSeconds;
+    Rule(int id, const std::string &type, float th = 0.0f, bool onAbove = true,
+         float hyst = 0.0f, int dwellSec = 0, int prio = 0,
+         SignalAggregate agg = SignalAggregate::LATEST, int windowSec = 0)
+        : deviceId(id), ruleType(type), threshold(th), turnOnAbove(onAbove),
+          hysteresis(hyst), minDwellSeconds(dwellSec), priority(prio),
+          aggregate(agg), windowSeconds(windowSec) {}
     virtual ~Rule() = default;
 };
 
+// Kinds of per-room signals the engine tracks
+enum class SignalKind {
+    TEMPERATURE,
+    MOTION,
+    COUNT
+};
+
+// One timestamped sensor value, addressed by signal id (see RuleEngine::signalId)
+struct SensorReading {
+    int signal;
+    float value;
+    long long timestampUs; // steady clock, microseconds
+};
+
+// How competing rules on one device are resolved
+enum class ConflictPolicy {
+    PRIORITY,   // highest priority wins, later rule wins a tie
+    PREFER_ON,  // any rule asking for ON wins (highest priority among them)
+    PREFER_OFF  // any rule asking for OFF wins (highest priority among them)
+};
+
+// Outcome of the resolution phase for one device in the last pass
+struct RuleResolution {
+    int deviceId;
+    int winnerRule;               // index into the rule list
+    bool on;
+    std::vector<int> losingRules; // rules that targeted the device but were overruled
+    bool written;                 // true if the device was actually actuated
+};
+
+// Counters for actuation traffic produced by applyRules
+struct RuleEngineStats {
+    unsigned long long evaluations = 0;
+    unsigned long long actuations = 0;       // device writes actually performed
+    unsigned long long suppressedWrites = 0; // writes the old level-triggered loop would have made
+    unsigned long long dwellHolds = 0;       // transitions postponed by minDwellSeconds
+    unsigned long long conflicts = 0;        // devices targeted by disagreeing rules
+};
+
 class RuleEngine {
 private:
+    // runtime state kept per rule, indexed like `rules`
+    struct RuleRuntime {
+        bool hasOutput = false;
+        bool outputOn = false;
+        std::chrono::steady_clock::time_point lastTransition;
+        int windowIndex = -1; // into signalWindows[signal], -1 for the latest value
+    };
+
     std::vector<Rule> rules;
-    std::unordered_map<std::string, float> roomTemperatureMap;
-    std::unordered_map<std::string, bool> roomMotionMap;
+    // one rule's vote for a device in the current pass
+    struct Proposal {
+        int deviceId;
+        int ruleIndex;
+        bool on;
+    };
+
+    std::vector<RuleRuntime> ruleRuntime;
+    std::vector<Proposal> proposals;            // scratch buffer reused across passes
+    std::vector<RuleResolution> lastResolutions;
+    ConflictPolicy policy = ConflictPolicy::PRIORITY;
+    RuleEngineStats stats;
+    // room names are interned once into dense ids; signal values live in a flat array
+    // indexed by roomId * SignalKind::COUNT + kind
+    std::unordered_map<std::string, int> roomIds;
+    std::vector<std::string> roomNames;
+    // dense id per Room::getId(), so applyRules doesn't build and hash the name every pass;
+    // the name is kept to notice a renamed room. It views the key in roomIds, which
+    // is node-based and never erased, so it outlives the Room and its arena.
+    struct RoomBinding {
+        std::string_view name;
+        int id;
+    };
+    std::unordered_map<int, RoomBinding> roomBindings;
+    std::vector<float> signalValues;
+    // sliding windows: one per registered window length for every signal
+    std::vector<int> windowLengths;
+    std::vector<std::vector<SignalWindow>> signalWindows;
+
+    // decide the desired output of a rule; keeps the previous output inside the hysteresis band
+    bool evaluateRule(const Rule &rule, const RuleRuntime &rt, bool deviceOn, float input) const;
+    // value a rule compares against its threshold (latest reading or a window aggregate)
+    float ruleInput(const Rule &rule, const RuleRuntime &rt, int roomId) const;
+    int windowIndexFor(int seconds);
+    // true if proposal a beats proposal b under the current policy
+    bool outranks(const Proposal &a, const Proposal &b) const;
 
 public:
     RuleEngine() = default;
@@ -32,14 +125,42 @@ public:
     void addRule(const Rule &rule);
     void applyRules(std::shared_ptr<Room> room);
 
+    // Room interning: returns the dense id of the room, registering it if needed
+    int registerRoom(const std::string &roomName);
+    int findRoom(const std::string &roomName) const; // -1 if unknown
+    int signalId(int roomId, SignalKind kind) const {
+        return roomId * static_cast<int>(SignalKind::COUNT) + static_cast<int>(kind);
+    }
+
     // Simulation setters
     void setRoomTemperature(const std::string &roomName, float temp);
     void setRoomMotion(const std::string &roomName, bool motionDetected);
 
-    float getRoomTemperature(const std::string &roomName);
-    bool getRoomMotion(const std::string &roomName);
+    float getRoomTemperature(const std::string &roomName) const;
+    bool getRoomMotion(const std::string &roomName) const;
+
+    // Bulk update from the ingestion pipeline; no logging per reading
+    void ingest(const SensorReading *readings, size_t count);
+
+    // Id-based access for hot paths, no string hashing
+    void setSignal(int signal, float value, long long timestampUs);
+    float getSignal(int signal) const { return signalValues[signal]; }
+    // aggregate over the last windowSeconds; falls back to the latest value if no window has data
+    float getSignalAggregate(int signal, SignalAggregate agg, int windowSeconds);
+    float getRoomTemperature(int roomId) const {
+        return signalValues[signalId(roomId, SignalKind::TEMPERATURE)];
+    }
+    bool getRoomMotion(int roomId) const {
+        return signalValues[signalId(roomId, SignalKind::MOTION)] != 0.0f;
+    }
+
+    void setConflictPolicy(ConflictPolicy p) { policy = p; }
+    const RuleEngineStats& getStats() const { return stats; }
+    const std::vector<RuleResolution>& getLastResolutions() const { return lastResolutions; }
 
     void printRules() const;
+    void printStats() const;
+    void printLastResolution() const;
     void startMonitoring(const std::shared_ptr<Room>& room);
 };
 
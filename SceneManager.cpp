@@ -1,16 +1,344 @@
 #include "SceneManager.h"
 #include <iostream>
+#include <cerrno>
+#include <cstdlib>
+#include <limits>
 #include <algorithm>
+#include <chrono>
+#include <exception>
+#include <functional>
 
-SceneManager::SceneManager(const std::map<std::string, std::shared_ptr<Room>>& rooms)
-    : rooms(rooms) {}
+namespace {
+// the whole text must be a decimal number that fits in an int32_t
+bool parseInt32(const std::string& text, int32_t& out) {
+    if (text.empty()) return false;
+    char* end = nullptr;
+    errno = 0;
+    long value = std::strtol(text.c_str(), &end, 10);
+    if (*end != '\0' || errno == ERANGE || value < std::numeric_limits<int32_t>::min() ||
+        value > std::numeric_limits<int32_t>::max())
+        return false;
+    out = static_cast<int32_t>(value);
+    return true;
+}
+
+bool sharesDevice(const std::vector<int>& a, const std::vector<int>& b) {
+    // both sorted
+    for (size_t i = 0, j = 0; i < a.size() && j < b.size();) {
+        if (a[i] == b[j]) return true;
+        if (a[i] < b[j]) ++i;
+        else ++j;
+    }
+    return false;
+}
+}
+
+SceneManager::SceneManager(const std::map<std::string, std::shared_ptr<Room>>& rooms,
+                           std::shared_ptr<DeviceRegistry> registry,
+                           std::shared_ptr<DatabaseManager> database)
+    : catalog(std::make_shared<const SceneCatalog>()), rooms(rooms), registry(registry), database(database),
+      transitions(std::make_shared<TransitionTable>()) {
+    transitions->owner = this;
+}
+
+SceneManager::~SceneManager() {
+    cancelAllTransitions();
+    std::lock_guard<std::mutex> lock(transitions->mutex);
+    transitions->owner = nullptr;
+}
+
+size_t SceneManager::storeScenes(std::vector<Scene>&& batch, std::vector<std::string>* errors,
+                                 size_t* storedDevices) {
+    if (batch.empty()) return 0;
+    // build handles, and plans of flat scenes, before taking the writer lock;
+    // composites are compiled on first apply, against the catalog they end up in
+    std::vector<SceneEntry> entries;
+    entries.reserve(batch.size());
+    for (auto& scene : batch) {
+        auto handle = std::make_shared<const Scene>(std::move(scene));
+        auto cache = std::make_shared<PlanCache>();
+        if (handle->includes.empty()) cache->plan = compilePlan(*handle, SceneCatalog());
+        entries.push_back({std::move(handle), 0, std::move(cache)});
+    }
 
-int SceneManager::findSceneIndex(const std::string& sceneName) const {
     std::lock_guard<std::mutex> lock(scenesMutex);
-    for (size_t i = 0; i < scenes.size(); ++i) {
-        if (scenes[i].name == sceneName) return static_cast<int>(i);
+    auto next = std::make_shared<SceneCatalog>(*currentCatalog());
+    std::vector<std::string> changed;
+    // needed only when a scene is replaced; built once and kept up to date
+    IncludeIndex includedBy;
+    bool indexed = false;
+    for (auto& entry : entries) {
+        auto it = next->find(entry.scene->name);
+        bool replaces = it != next->end();
+        if (replaces && !indexed) {
+            for (const auto& pair : *next)
+                for (const auto& name : pair.second.scene->includes) includedBy[name].push_back(&pair.first);
+            indexed = true;
+        }
+        std::string error;
+        if (!checkIncludes(*next, replaces ? &includedBy : nullptr, *entry.scene, error)) {
+            if (errors) errors->push_back(error);
+            continue;
+        }
+        // a replaced scene keeps its place in the list
+        entry.order = replaces ? it->second.order : nextOrder++;
+        changed.push_back(entry.scene->name);
+        if (storedDevices) *storedDevices += entry.scene->deviceStates.size();
+        if (indexed && replaces) {
+            for (const auto& name : it->second.scene->includes) {
+                auto& parents = includedBy[name];
+                parents.erase(std::remove(parents.begin(), parents.end(), &it->first), parents.end());
+            }
+        }
+        auto& slot = *next->insert_or_assign(entry.scene->name, std::move(entry)).first;
+        if (indexed)
+            for (const auto& name : slot.second.scene->includes) includedBy[name].push_back(&slot.first);
     }
-    return -1;
+    if (changed.empty()) return 0;
+    invalidateDependents(*next, changed);
+    std::atomic_store(&catalog, std::shared_ptr<const SceneCatalog>(std::move(next)));
+    return changed.size();
+}
+
+bool SceneManager::storeScene(Scene&& scene, std::string* error) {
+    std::vector<Scene> batch;
+    batch.push_back(std::move(scene));
+    std::vector<std::string> errors;
+    if (storeScenes(std::move(batch), &errors) == 1) return true;
+    if (error && !errors.empty()) *error = errors.front();
+    return false;
+}
+
+bool SceneManager::checkIncludes(const SceneCatalog& catalog, const IncludeIndex* includedBy,
+                                 const Scene& scene, std::string& error) {
+    // depth-first walk through the includes; reaching the scene itself is a cycle
+    std::vector<const std::string*> pending;
+    std::unordered_map<std::string, bool> seen;
+    for (const auto& name : scene.includes) {
+        if (catalog.find(name) == catalog.end()) {
+            error = "Scene '" + scene.name + "' includes unknown scene '" + name + "'.";
+            return false;
+        }
+        pending.push_back(&name);
+    }
+    while (!pending.empty()) {
+        const std::string& name = *pending.back();
+        pending.pop_back();
+        if (name == scene.name) {
+            error = "Scene '" + scene.name + "' would include itself.";
+            return false;
+        }
+        if (!seen.emplace(name, true).second) continue;
+        auto it = catalog.find(name);
+        if (it == catalog.end()) continue;
+        for (const auto& included : it->second.scene->includes) pending.push_back(&included);
+    }
+
+    // longest chain through the scene: levels of scenes including it (only when it
+    // replaces one) plus levels of includes below it; the catalog itself is acyclic
+    std::unordered_map<std::string, int> below;
+    std::function<int(const Scene&)> levelsBelow = [&](const Scene& s) {
+        auto memo = below.find(s.name);
+        if (memo != below.end()) return memo->second;
+        int levels = 0;
+        for (const auto& name : s.includes) {
+            auto it = catalog.find(name);
+            if (it != catalog.end()) levels = std::max(levels, 1 + levelsBelow(*it->second.scene));
+        }
+        below[s.name] = levels;
+        return levels;
+    };
+    int depth = levelsBelow(scene);
+    if (includedBy && includedBy->count(scene.name) > 0) {
+        std::unordered_map<std::string, int> above;
+        std::function<int(const std::string&)> levelsAbove = [&](const std::string& name) {
+            auto memo = above.find(name);
+            if (memo != above.end()) return memo->second;
+            int levels = 0;
+            auto it = includedBy->find(name);
+            if (it != includedBy->end())
+                for (const std::string* parent : it->second) levels = std::max(levels, 1 + levelsAbove(*parent));
+            above[name] = levels;
+            return levels;
+        };
+        depth += levelsAbove(scene.name);
+    }
+    if (depth > MAX_INCLUDE_DEPTH) {
+        error = "Scene '" + scene.name + "' would nest includes more than " +
+                std::to_string(MAX_INCLUDE_DEPTH) + " levels deep.";
+        return false;
+    }
+    return true;
+}
+
+void SceneManager::invalidateDependents(SceneCatalog& catalog, const std::vector<std::string>& changed) {
+    // memoised: does this scene (transitively) include one of the changed scenes?
+    std::unordered_map<std::string, bool> affected;
+    for (const auto& name : changed) affected[name] = true;
+    std::function<bool(const std::string&)> dependsOnChange = [&](const std::string& name) {
+        auto memo = affected.find(name);
+        if (memo != affected.end()) return memo->second;
+        affected[name] = false; // the catalog is acyclic; this only stops revisits
+        bool result = false;
+        auto it = catalog.find(name);
+        if (it != catalog.end()) {
+            for (const auto& included : it->second.scene->includes)
+                if (dependsOnChange(included)) result = true;
+        }
+        affected[name] = result;
+        return result;
+    };
+
+    for (auto& pair : catalog) {
+        if (pair.second.scene->includes.empty()) continue;
+        if (std::find(changed.begin(), changed.end(), pair.first) != changed.end()) continue;
+        // a fresh cache, so a refresh racing with this write can't keep a stale plan
+        if (dependsOnChange(pair.first)) pair.second.planCache = std::make_shared<PlanCache>();
+    }
+}
+
+void SceneManager::flattenScene(const SceneCatalog& catalog, const Scene& scene,
+                                std::vector<SceneDeviceState>& out, std::unordered_map<int, size_t>& index,
+                                int depth) {
+    // cycles and deeper chains are refused when scenes are stored; just a guard
+    if (depth > MAX_INCLUDE_DEPTH) return;
+    for (const auto& name : scene.includes) {
+        auto it = catalog.find(name);
+        if (it != catalog.end()) flattenScene(catalog, *it->second.scene, out, index, depth + 1);
+    }
+    for (const auto& sds : scene.deviceStates) {
+        auto ins = index.emplace(sds.deviceId, out.size());
+        if (ins.second) {
+            out.push_back(sds);
+            continue;
+        }
+        SceneDeviceState& merged = out[ins.first->second];
+        merged.state = sds.state;
+        for (int i = 0; i < MAX_DEVICE_ATTRIBUTES; ++i) {
+            if (!(sds.attributeMask & (1u << i))) continue;
+            merged.attributes[i] = sds.attributes[i];
+            merged.attributeMask |= static_cast<uint8_t>(1u << i);
+        }
+    }
+}
+
+SceneHandle SceneManager::findScene(const std::string& sceneName) const {
+    auto scenes = currentCatalog();
+    auto it = scenes->find(sceneName);
+    return it == scenes->end() ? nullptr : it->second.scene;
+}
+
+std::shared_ptr<const ScenePlan> SceneManager::compilePlan(const Scene& scene, const SceneCatalog& catalog) const {
+    auto plan = std::make_shared<ScenePlan>();
+    // read the generation first: a change during compilation makes the plan stale
+    plan->generation = registry->getGeneration();
+
+    const std::vector<SceneDeviceState>* states = &scene.deviceStates;
+    std::vector<SceneDeviceState> flattened;
+    if (!scene.includes.empty()) {
+        std::unordered_map<int, size_t> index;
+        flattenScene(catalog, scene, flattened, index);
+        states = &flattened;
+    }
+
+    std::shared_ptr<Room> targetRoom;
+    if (scene.type == SceneType::ROOM) {
+        auto roomIt = rooms.find(scene.targetRoom);
+        if (roomIt != rooms.end()) targetRoom = roomIt->second;
+    }
+
+    struct Resolved {
+        std::shared_ptr<Room> room;
+        const SceneDeviceState* sds;
+        std::shared_ptr<Device> device;
+    };
+    std::vector<Resolved> resolved;
+    resolved.reserve(states->size());
+    for (const auto& sds : *states) {
+        std::shared_ptr<Room> owner;
+        auto device = registry->find(sds.deviceId, owner);
+        // room scenes only touch devices that still live in their room
+        if (!device || (scene.type == SceneType::ROOM && owner != targetRoom)) {
+            plan->missing.push_back(sds.deviceId);
+            continue;
+        }
+        resolved.push_back({std::move(owner), &sds, std::move(device)});
+    }
+    std::stable_sort(resolved.begin(), resolved.end(), [](const Resolved& a, const Resolved& b) {
+        return std::less<Room*>()(a.room.get(), b.room.get());
+    });
+
+    plan->steps.reserve(resolved.size());
+    for (auto& r : resolved) {
+        if (plan->rooms.empty() || plan->rooms.back().room != r.room)
+            plan->rooms.push_back({r.room, plan->steps.size(), plan->steps.size()});
+        plan->stripeMask |= stripeBit(r.sds->deviceId);
+        ScenePlanStep step{std::move(r.device), r.sds->state, r.sds->attributeMask, {}};
+        // in the form the device stores them, so the apply diff converges: values
+        // clamped to the type's range, attributes the type lacks dropped
+        for (int i = 0; i < MAX_DEVICE_ATTRIBUTES; ++i) {
+            const AttributeSpec& spec = attributeSpec(step.device->getType(), i);
+            if (spec.attribute == DeviceAttribute::NONE) {
+                step.attributeMask &= static_cast<uint8_t>(~(1u << i));
+                continue;
+            }
+            step.attributes[i] = std::clamp(r.sds->attributes[i], spec.minValue, spec.maxValue);
+        }
+        plan->steps.push_back(std::move(step));
+        plan->rooms.back().end = plan->steps.size();
+    }
+    return plan;
+}
+
+bool SceneManager::lookupForApply(const std::string& sceneName, SceneHandle& scene,
+                                  std::shared_ptr<const ScenePlan>& plan) {
+    auto scenes = currentCatalog();
+    auto it = scenes->find(sceneName);
+    if (it == scenes->end()) return false;
+    scene = it->second.scene;
+    plan = std::atomic_load(&it->second.planCache->plan);
+    if (plan && plan->generation == registry->getGeneration()) return true;
+
+    // devices were added or removed since the plan was built; racing refreshes
+    // compile the same plan, whichever is stored last wins
+    plan = compilePlan(*scene, *scenes);
+    std::atomic_store(&it->second.planCache->plan, plan);
+    return true;
+}
+
+bool SceneManager::promptDeviceState(const Device& device, SceneDeviceState& out) const {
+    std::string userInput;
+    std::cout << "Device: " << device.getName() << " (ID: " << device.getId()
+              << ") - Current state: " << device.getStateName() << "\n";
+    auto deviceType = device.getType();
+    const DeviceTypeTraits& traits = deviceTraits(deviceType);
+    std::cout << "Enter desired state for this device in scene (" << stateName(traits.onState) << "/"
+              << stateName(traits.offState) << "/skip): ";
+    std::getline(std::cin, userInput);
+
+    if (userInput == "skip" || userInput == "SKIP" || userInput.empty()) {
+        return false;
+    }
+
+    out.deviceId = device.getId();
+    if (!parseStateName(deviceType, userInput, out.state))
+        return false; // invalid input → skip
+
+    out.attributeMask = 0;
+    for (int i = 0; i < MAX_DEVICE_ATTRIBUTES; ++i) {
+        const AttributeSpec& spec = attributeSpec(deviceType, i);
+        if (spec.attribute == DeviceAttribute::NONE) continue;
+        std::cout << "  " << spec.label << " [current " << device.getAttributeAt(i) << ", blank to leave as is]: ";
+        std::getline(std::cin, userInput);
+        if (userInput.empty()) continue;
+        try {
+            out.attributes[i] = std::stoi(userInput);
+            out.attributeMask |= static_cast<uint8_t>(1u << i);
+        } catch (...) {
+            std::cout << "  Not a number, attribute skipped.\n";
+        }
+    }
+    return true;
 }
 
 void SceneManager::createRoomScene(const std::string& sceneName, const std::string& roomName) {
@@ -21,8 +349,7 @@ void SceneManager::createRoomScene(const std::string& sceneName, const std::stri
     }
 
     auto room = it->second;
-    auto roomDevices = room->getDevices();
-    if (roomDevices.empty()) {
+    if (room->deviceCount() == 0) {
         std::cerr << "No devices found in this room!" << std::endl;
         return;
     }
@@ -34,52 +361,17 @@ void SceneManager::createRoomScene(const std::string& sceneName, const std::stri
 
     std::cout << "\nConfiguring scene '" << sceneName << "' for room '" << roomName << "':\n";
 
-    for (auto& devicePtr : roomDevices) {
-        if (!devicePtr) continue;
-        std::string userInput;
-        std::cout << "Device: " << devicePtr->getName() << " (ID: " << devicePtr->getId()
-                  << ") - Current state: " << devicePtr->getStateString() << "\n";
-        auto deviceType = devicePtr->getType();
-        if (deviceType == DeviceType::SENSOR)
-            std::cout << "Enter desired state for this device in scene (ACTIVE/INACTIVE/skip): ";
-        else
-            std::cout << "Enter desired state for this device in scene (ON/OFF/skip): ";
-        std::getline(std::cin, userInput);
-
-        if (userInput == "skip" || userInput == "SKIP" || userInput.empty()) {
-            continue;
-        }
-
+    room->forEachDevice([&](const Device& device) {
         SceneDeviceState sds;
-        sds.deviceId = devicePtr->getId();
-
-        if (deviceType == DeviceType::SENSOR) {
-            if (userInput == "ACTIVE" || userInput == "active")
-                sds.state = DeviceState::ACTIVE;
-            else if (userInput == "INACTIVE" || userInput == "inactive")
-                sds.state = DeviceState::INACTIVE;
-            else
-                continue; // invalid input → skip
-        } 
-        else {
-            if (userInput == "ON" || userInput == "on")
-                sds.state = DeviceState::ON;
-            else if (userInput == "OFF" || userInput == "off")
-                sds.state = DeviceState::OFF;
-            else
-                continue; // invalid input → skip
-        }
-
-        scene.deviceStates.push_back(sds);
-    }
+        if (promptDeviceState(device, sds))
+            scene.deviceStates.push_back(sds);
+    });
 
-    {
-        std::lock_guard<std::mutex> lock(scenesMutex);
-        scenes.push_back(scene);
-    }
+    size_t configured = scene.deviceStates.size();
+    storeScene(std::move(scene));
 
     std::cout << "\nRoom scene '" << sceneName << "' created successfully with "
-              << scene.deviceStates.size() << " devices configured.\n";
+              << configured << " devices configured.\n";
 }
 
 
@@ -99,147 +391,731 @@ void SceneManager::createHouseScene(const std::string& sceneName) {
     for (auto& pair : rooms) {
         auto& roomName = pair.first;
         auto roomPtr = pair.second;
-        auto roomDevices = roomPtr->getDevices();
 
-        if (roomDevices.empty()) {
+        if (roomPtr->deviceCount() == 0) {
             std::cout << "\n[Room: " << roomName << "] No devices found, skipping...\n";
             continue;
         }
 
         std::cout << "\n[Room: " << roomName << "]\n";
 
-        for (auto& devicePtr : roomDevices) {
-            if (!devicePtr) continue;
+        roomPtr->forEachDevice([&](const Device& device) {
+            SceneDeviceState sds;
+            if (promptDeviceState(device, sds))
+                scene.deviceStates.push_back(sds);
+        });
+    }
+
+    size_t configured = scene.deviceStates.size();
+    storeScene(std::move(scene));
+
+    std::cout << "\nHouse scene '" << sceneName << "' created successfully with "
+              << configured << " devices configured.\n";
+}
+
 
-            std::string userInput;
-            std::cout << "Device: " << devicePtr->getName() << " (ID: " << devicePtr->getId()
-                      << ") - Current state: " << devicePtr->getStateString() << "\n";
-            auto deviceType = devicePtr->getType();
-            if (deviceType == DeviceType::SENSOR)
-                std::cout << "Enter desired state for this device in scene (ACTIVE/INACTIVE/skip): ";
-            else
-                std::cout << "Enter desired state for this device in scene (ON/OFF/skip): ";
-            std::getline(std::cin, userInput);
+bool SceneManager::validateScene(const Scene& scene, std::string* error) const {
+    auto fail = [&](const std::string& message) {
+        if (error) *error = message;
+        return false;
+    };
+    if (scene.name.empty()) return fail("Scene name is empty.");
+    if (scene.type == SceneType::ROOM && rooms.find(scene.targetRoom) == rooms.end())
+        return fail("Room '" + scene.targetRoom + "' not found.");
 
-            if (userInput == "skip" || userInput == "SKIP" || userInput.empty()) {
-                continue;
+    for (const auto& sds : scene.deviceStates) {
+        auto device = registry->find(sds.deviceId);
+        if (device && !isValidState(device->getType(), sds.state))
+            return fail("State " + std::string(stateName(sds.state)) + " is not valid for device "
+                        + std::to_string(sds.deviceId) + ".");
+    }
+    return true;
+}
+
+bool SceneManager::createScene(const std::string& sceneName, SceneType type, const std::string& roomName,
+                               std::vector<SceneDeviceState> deviceStates, std::string* error) {
+    Scene scene;
+    scene.name = sceneName;
+    scene.type = type;
+    scene.targetRoom = type == SceneType::ROOM ? roomName : "";
+    scene.deviceStates = std::move(deviceStates);
+    if (!validateScene(scene, error)) return false;
+    return storeScene(std::move(scene), error);
+}
+
+bool SceneManager::composeScene(const std::string& sceneName, SceneType type, const std::string& roomName,
+                                std::vector<std::string> includes, std::vector<SceneDeviceState> overrides,
+                                std::string* error) {
+    Scene scene;
+    scene.name = sceneName;
+    scene.type = type;
+    scene.targetRoom = type == SceneType::ROOM ? roomName : "";
+    scene.includes = std::move(includes);
+    scene.deviceStates = std::move(overrides);
+    if (!validateScene(scene, error)) return false;
+    // includes are checked against the catalog the scene is stored into
+    return storeScene(std::move(scene), error);
+}
+
+bool SceneManager::captureScene(const std::string& sceneName, const SceneCaptureOptions& options,
+                                std::string* error) {
+    auto fail = [&](const std::string& message) {
+        if (error) *error = message;
+        return false;
+    };
+    Scene scene;
+    scene.name = sceneName;
+    scene.type = options.room.empty() ? SceneType::HOUSE : SceneType::ROOM;
+    scene.targetRoom = options.room;
+
+    // effective values of the baseline, indexed by device id
+    std::vector<SceneDeviceState> baseline;
+    std::unordered_map<int, size_t> baselineIndex;
+    if (!options.baseline.empty()) {
+        auto scenes = currentCatalog();
+        auto it = scenes->find(options.baseline);
+        if (it == scenes->end()) return fail("Baseline scene '" + options.baseline + "' not found.");
+        // a wider baseline would make the room scene apply devices outside its room
+        const Scene& base = *it->second.scene;
+        if (scene.type == SceneType::ROOM && (base.type != SceneType::ROOM || base.targetRoom != scene.targetRoom))
+            return fail("Baseline scene '" + options.baseline + "' is not a scene of room " + scene.targetRoom + ".");
+        flattenScene(*scenes, *it->second.scene, baseline, baselineIndex);
+        scene.includes.push_back(options.baseline);
+    }
+
+    auto capture = [&](const Device& device) {
+        if (options.filter && !options.filter(device)) return;
+        SceneDeviceState sds;
+        sds.deviceId = device.getId();
+        sds.state = device.getState();
+        if (options.attributes) {
+            for (int i = 0; i < MAX_DEVICE_ATTRIBUTES; ++i) {
+                DeviceAttribute attribute = attributeSpec(device.getType(), i).attribute;
+                if (attribute == DeviceAttribute::NONE || attribute == DeviceAttribute::READING) continue;
+                sds.attributes[i] = device.getAttributeAt(i);
+                sds.attributeMask |= static_cast<uint8_t>(1u << i);
             }
+        }
+        if (!baselineIndex.empty()) {
+            auto known = baselineIndex.find(sds.deviceId);
+            if (known != baselineIndex.end()) {
+                const SceneDeviceState& base = baseline[known->second];
+                bool differs = base.state != sds.state;
+                for (int i = 0; i < MAX_DEVICE_ATTRIBUTES && !differs; ++i) {
+                    if (sds.attributeMask & (1u << i))
+                        differs = !(base.attributeMask & (1u << i)) || base.attributes[i] != sds.attributes[i];
+                }
+                if (!differs) return;
+            }
+        }
+        scene.deviceStates.push_back(sds);
+    };
 
-            SceneDeviceState sds;
-            sds.deviceId = devicePtr->getId();
-
-            if (deviceType == DeviceType::SENSOR) {
-                if (userInput == "ACTIVE" || userInput == "active")
-                    sds.state = DeviceState::ACTIVE;
-                else if (userInput == "INACTIVE" || userInput == "inactive")
-                    sds.state = DeviceState::INACTIVE;
-                else
-                    continue; // invalid input → skip
-            } 
-            else {
-                if (userInput == "ON" || userInput == "on")
-                    sds.state = DeviceState::ON;
-                else if (userInput == "OFF" || userInput == "off")
-                    sds.state = DeviceState::OFF;
-                else
-                    continue; // invalid input → skip
+    if (!options.room.empty()) {
+        auto it = rooms.find(options.room);
+        if (it == rooms.end()) return fail("Room '" + options.room + "' not found.");
+        it->second->forEachDevice(capture);
+    } else {
+        for (const auto& pair : rooms) pair.second->forEachDevice(capture);
+    }
+    return storeScene(std::move(scene), error);
+}
+
+SceneImportStats SceneManager::importScenes(std::istream& in) {
+    // scenes are published in batches, so a large import creates few catalog versions
+    const size_t BATCH_SIZE = 256;
+    SceneImportStats stats;
+    std::string name, room;
+    SceneType type = SceneType::HOUSE;
+    std::vector<SceneDeviceState> entries;
+    std::vector<std::string> includes;
+    std::vector<Scene> batch;
+    bool open = false;
+
+    auto publish = [&]() {
+        std::vector<std::string> errors;
+        size_t offered = batch.size();
+        size_t stored = storeScenes(std::move(batch), &errors, &stats.devices);
+        batch.clear();
+        stats.rejected += offered - stored;
+        stats.scenes -= offered - stored;
+        for (const auto& error : errors) std::cerr << "Scene not imported: " << error << std::endl;
+    };
+
+    auto flush = [&]() {
+        if (!open) return;
+        Scene scene;
+        scene.name = name;
+        scene.type = type;
+        scene.targetRoom = type == SceneType::ROOM ? room : "";
+        scene.includes = std::move(includes);
+        scene.deviceStates = std::move(entries);
+        includes.clear();
+        entries.clear();
+        open = false;
+
+        std::string error;
+        if (!validateScene(scene, &error)) {
+            stats.rejected++;
+            std::cerr << "Scene '" << scene.name << "' not imported: " << error << std::endl;
+            return;
+        }
+        stats.scenes++;
+        batch.push_back(std::move(scene));
+        // a scene may include one defined earlier in the same batch
+        if (batch.size() >= BATCH_SIZE) publish();
+    };
+
+    std::string line;
+    std::string fields[7];
+    size_t lineNo = 0;
+    while (std::getline(in, line)) {
+        ++lineNo;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+
+        size_t n = 0, pos = 0;
+        for (; n < 7; ++n) {
+            size_t comma = line.find(',', pos);
+            fields[n] = line.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+            if (comma == std::string::npos) { ++n; break; }
+            pos = comma + 1;
+        }
+        SceneType rowType;
+        if (fields[1] == "HOUSE") rowType = SceneType::HOUSE;
+        else if (fields[1] == "ROOM") rowType = SceneType::ROOM;
+        else n = 0;
+        if (n < 3 || fields[0].empty()) {
+            std::cerr << "Skipping malformed scene line " << lineNo << std::endl;
+            stats.skippedLines++;
+            continue;
+        }
+
+        if (!open || fields[0] != name) {
+            flush();
+            name = fields[0];
+            type = rowType;
+            room = fields[2];
+            open = true;
+        }
+        if (n < 4 || fields[3].empty()) continue; // scene without devices
+        if (fields[3] == "include") {
+            if (n < 5 || fields[4].empty()) {
+                std::cerr << "Skipping malformed scene line " << lineNo << std::endl;
+                stats.skippedLines++;
+                continue;
             }
+            includes.push_back(fields[4]);
+            continue;
+        }
 
-            scene.deviceStates.push_back(sds);
+        SceneDeviceState sds;
+        int32_t deviceId = 0;
+        bool valid = parseInt32(fields[3], deviceId) && n >= 5 && parseStateName(fields[4], sds.state);
+        sds.deviceId = deviceId;
+        for (int i = 0; valid && i < MAX_DEVICE_ATTRIBUTES; ++i) {
+            if (static_cast<size_t>(5 + i) >= n || fields[5 + i].empty()) continue;
+            valid = parseInt32(fields[5 + i], sds.attributes[i]);
+            sds.attributeMask |= static_cast<uint8_t>(1u << i);
+        }
+        if (!valid) {
+            std::cerr << "Skipping malformed scene line " << lineNo << std::endl;
+            stats.skippedLines++;
+            continue;
         }
+        entries.push_back(sds);
     }
+    flush();
+    publish();
+    return stats;
+}
 
-    {
-        std::lock_guard<std::mutex> lock(scenesMutex);
-        scenes.push_back(scene);
-    }
+size_t SceneManager::exportScenes(std::ostream& out) const {
+    // export one catalog version, in creation order
+    auto scenes = currentCatalog();
+    std::vector<std::pair<uint64_t, SceneHandle>> byOrder;
+    byOrder.reserve(scenes->size());
+    for (const auto& pair : *scenes) byOrder.emplace_back(pair.second.order, pair.second.scene);
+    std::sort(byOrder.begin(), byOrder.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
 
-    std::cout << "\nHouse scene '" << sceneName << "' created successfully with "
-              << scene.deviceStates.size() << " devices configured.\n";
-}
+    // a replaced scene may include newer ones; write included scenes first so
+    // the file imports again
+    std::vector<SceneHandle> ordered;
+    ordered.reserve(byOrder.size());
+    std::unordered_map<std::string, bool> emitted;
+    std::function<void(const SceneHandle&)> emit = [&](const SceneHandle& scene) {
+        if (!emitted.emplace(scene->name, true).second) return;
+        for (const auto& name : scene->includes) {
+            auto it = scenes->find(name);
+            if (it != scenes->end()) emit(it->second.scene);
+        }
+        ordered.push_back(scene);
+    };
+    for (const auto& entry : byOrder) emit(entry.second);
 
+    out << "# scene,type,room,device_id,state,attr0,attr1\n";
+    size_t written = 0;
+    for (const auto& entry : ordered) {
+        const Scene& scene = *entry;
+        if (scene.name.find(',') != std::string::npos || scene.targetRoom.find(',') != std::string::npos) {
+            std::cerr << "Scene '" << scene.name << "' not exported: names cannot contain commas." << std::endl;
+            continue;
+        }
+        const char* type = scene.type == SceneType::ROOM ? "ROOM" : "HOUSE";
+        if (scene.deviceStates.empty() && scene.includes.empty())
+            out << scene.name << ',' << type << ',' << scene.targetRoom << ",,,,\n";
+        for (const auto& included : scene.includes)
+            out << scene.name << ',' << type << ',' << scene.targetRoom << ",include," << included << ",,\n";
+        for (const auto& sds : scene.deviceStates) {
+            out << scene.name << ',' << type << ',' << scene.targetRoom << ',' << sds.deviceId << ','
+                << stateName(sds.state);
+            for (int i = 0; i < MAX_DEVICE_ATTRIBUTES; ++i) {
+                out << ',';
+                if (sds.attributeMask & (1u << i)) out << sds.attributes[i];
+            }
+            out << '\n';
+        }
+        ++written;
+    }
+    return written;
+}
 
 void SceneManager::listSceneNames() const {
-    std::lock_guard<std::mutex> lock(scenesMutex);
-    if (scenes.empty()) {
+    auto scenes = currentCatalog();
+    if (scenes->empty()) {
         std::cout << "No scenes available." << std::endl;
         return;
     }
 
+    std::vector<const SceneEntry*> ordered;
+    ordered.reserve(scenes->size());
+    for (const auto& pair : *scenes) ordered.push_back(&pair.second);
+    std::sort(ordered.begin(), ordered.end(),
+              [](const SceneEntry* a, const SceneEntry* b) { return a->order < b->order; });
+
     std::cout << "\n===== Available Scenes =====" << std::endl;
     int count = 1;
-    for (const auto& scene : scenes) {
+    for (const SceneEntry* entry : ordered) {
+        const Scene& scene = *entry->scene;
         std::cout << count++ << ". " << scene.name;
         if (scene.type == SceneType::ROOM) {
             std::cout << " (Room: " << scene.targetRoom << ")";
         } else {
             std::cout << " (House-wide)";
         }
+        if (!scene.includes.empty()) {
+            std::cout << " includes ";
+            for (size_t i = 0; i < scene.includes.size(); ++i)
+                std::cout << (i ? ", " : "") << scene.includes[i];
+        }
         std::cout << std::endl;
     }
     std::cout << "===========================\n" << std::endl;
 }
 
-bool SceneManager::applyScene(const std::string& sceneName) {
-    int idx = findSceneIndex(sceneName);
-    if (idx < 0) {
-        std::cerr << "Error: Scene '" << sceneName << "' not found." << std::endl;
-        return false;
+void SceneManager::applyRoomRange(const ScenePlan& plan, const ScenePlan::RoomRange& range,
+                                  SceneApplyMode mode, RangeOutcome& out) {
+    auto start = std::chrono::steady_clock::now();
+    int roomId = range.room ? range.room->getId() : -1;
+    auto applySteps = [&]() {
+        for (size_t i = range.begin; i < range.end; ++i) {
+            const ScenePlanStep& step = plan.steps[i];
+            Device& device = *step.device;
+            // diff against the current values first; matching devices are not written
+            UndoEntry undo{&device, roomId, false, device.getState(), 0, {}};
+            bool ok = true;
+            try {
+                if (undo.state != step.state) {
+                    undo.stateWritten = true;
+                    device.apply(step.state, ChangeSource::SCENE);
+                    ok = device.getState() == step.state;
+                }
+                for (int a = 0; a < MAX_DEVICE_ATTRIBUTES; ++a) {
+                    if (!(step.attributeMask & (1u << a))) continue;
+                    int32_t current = device.getAttributeAt(a);
+                    if (current == step.attributes[a]) continue;
+                    undo.attributes[a] = current;
+                    undo.attributeMask |= static_cast<uint8_t>(1u << a);
+                    device.setAttributeAt(a, step.attributes[a], ChangeSource::SCENE);
+                }
+            } catch (const std::exception& e) {
+                ok = false;
+                if (out.result.error.empty())
+                    out.result.error = "Device " + std::to_string(device.getId()) + ": " + e.what();
+            }
+
+            bool written = undo.stateWritten || undo.attributeMask != 0;
+            if (written) out.undo.push_back(undo);
+            if (!ok) {
+                out.failed = true;
+                out.result.failed.push_back(device.getId());
+                if (out.result.error.empty())
+                    out.result.error = "Device " + std::to_string(device.getId()) + " did not reach "
+                                     + std::string(stateName(step.state)) + ".";
+                if (mode == SceneApplyMode::TRANSACTIONAL) return;
+            } else {
+                (written ? out.result.changed : out.result.unchanged).push_back(device.getId());
+            }
+        }
+    };
+    if (range.room) range.room->withDevicesLocked(applySteps);
+    else applySteps();
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    out.result.roomTimings.push_back({range.room ? std::string(range.room->getName()) : std::string(),
+                                      range.end - range.begin, ms});
+}
+
+void SceneManager::rollback(std::vector<RangeOutcome>& outcomes) {
+    // newest first, so a device written twice ends up in its original state
+    for (auto out = outcomes.rbegin(); out != outcomes.rend(); ++out) {
+        for (auto undo = out->undo.rbegin(); undo != out->undo.rend(); ++undo) {
+            try {
+                for (int a = 0; a < MAX_DEVICE_ATTRIBUTES; ++a) {
+                    if (undo->attributeMask & (1u << a))
+                        undo->device->setAttributeAt(a, undo->attributes[a], ChangeSource::SCENE);
+                }
+                if (undo->stateWritten) undo->device->apply(undo->state, ChangeSource::SCENE);
+            } catch (const std::exception& e) {
+                std::cerr << "Rollback of device " << undo->device->getId() << " failed: " << e.what() << std::endl;
+            }
+        }
+        out->undo.clear();
     }
+}
+
+void SceneManager::acquireStripes(uint64_t mask) {
+    std::unique_lock<std::mutex> lock(stripeMutex);
+    stripesReleased.wait(lock, [&]() { return (busyStripes & mask) == 0; });
+    busyStripes |= mask;
+}
 
-    // Copy the scene under lock, operate on local copy to minimize locked duration
-    Scene sceneCopy;
+void SceneManager::releaseStripes(uint64_t mask) {
     {
-        std::lock_guard<std::mutex> lock(scenesMutex);
-        sceneCopy = scenes[static_cast<size_t>(idx)];
+        std::lock_guard<std::mutex> lock(stripeMutex);
+        busyStripes &= ~mask;
     }
+    stripesReleased.notify_all();
+}
 
-    std::cout << "Applying scene: '" << sceneName << "'..." << std::endl;
+void SceneManager::setApplyConcurrency(size_t maxRooms) {
+    // applies still using the old pool keep it alive until they finish
+    std::atomic_store(&applyPool, maxRooms > 1 ? std::make_shared<ThreadPool>(maxRooms)
+                                               : std::shared_ptr<ThreadPool>());
+}
 
-    if (sceneCopy.type == SceneType::ROOM) {
-        auto roomIt = rooms.find(sceneCopy.targetRoom);
-        if (roomIt == rooms.end()) {
-            std::cerr << "Room " << sceneCopy.targetRoom << " not found." << std::endl;
-            return false;
+size_t SceneManager::getApplyConcurrency() const {
+    auto pool = std::atomic_load(&applyPool);
+    return pool ? pool->size() : 1;
+}
+
+SceneApplyResult SceneManager::applyScene(const std::string& sceneName, SceneApplyMode mode) {
+    SceneApplyResult result;
+    // one lookup under the lock; the handles keep scene and plan alive while we apply
+    SceneHandle scene;
+    std::shared_ptr<const ScenePlan> plan;
+    if (!lookupForApply(sceneName, scene, plan)) {
+        result.error = "Scene '" + sceneName + "' not found.";
+        return result;
+    }
+
+    if (scene->type == SceneType::ROOM && rooms.find(scene->targetRoom) == rooms.end()) {
+        result.error = "Room " + scene->targetRoom + " not found.";
+        return result;
+    }
+
+    if (mode == SceneApplyMode::TRANSACTIONAL && !plan->missing.empty()) {
+        result.missing = plan->missing;
+        result.error = std::to_string(plan->missing.size()) + " device(s) of the scene are missing.";
+        return result;
+    }
+
+    if (transitions->activeCount.load() > 0) {
+        std::lock_guard<std::mutex> lock(transitions->mutex);
+        supersedeLocked(*transitions, *plan);
+    }
+    result = applyPlan(*plan, mode);
+    result.missing = plan->missing;
+    return result;
+}
+
+SceneApplyResult SceneManager::applyPlan(const ScenePlan& plan, SceneApplyMode mode) {
+    SceneApplyResult result;
+    std::shared_ptr<ThreadPool> pool = std::atomic_load(&applyPool);
+
+    struct StripeClaim {
+        SceneManager& manager;
+        uint64_t mask;
+        ~StripeClaim() { manager.releaseStripes(mask); }
+    };
+    acquireStripes(plan.stripeMask);
+    StripeClaim isolation{*this, plan.stripeMask};
+    auto start = std::chrono::steady_clock::now();
+
+    // each room records into its own outcome, merged in plan order
+    std::vector<RangeOutcome> outcomes(plan.rooms.size());
+    bool failed = false;
+    if (pool && plan.rooms.size() > 1) {
+        pool->parallelFor(plan.rooms.size(), [&](size_t r) {
+            applyRoomRange(plan, plan.rooms[r], mode, outcomes[r]);
+        });
+        for (const auto& out : outcomes) failed = failed || out.failed;
+    } else {
+        for (size_t r = 0; r < plan.rooms.size(); ++r) {
+            applyRoomRange(plan, plan.rooms[r], mode, outcomes[r]);
+            failed = failed || outcomes[r].failed;
+            if (failed && mode == SceneApplyMode::TRANSACTIONAL) break;
         }
+    }
 
-        auto room = roomIt->second;
-        auto deviceList = room->getDevices(); // cache the vector locally
-        for (const auto& sds : sceneCopy.deviceStates) {
-            for (auto& devicePtr : deviceList) {
-                if (!devicePtr) continue;
-                if (devicePtr->getId() == sds.deviceId) {
-                    devicePtr->setState(sds.state);
-                    break; // stop inner loop once matched
-                }
-            }
+    for (auto& out : outcomes) {
+        SceneApplyResult& part = out.result;
+        result.changed.insert(result.changed.end(), part.changed.begin(), part.changed.end());
+        result.unchanged.insert(result.unchanged.end(), part.unchanged.begin(), part.unchanged.end());
+        result.failed.insert(result.failed.end(), part.failed.begin(), part.failed.end());
+        result.roomTimings.insert(result.roomTimings.end(), part.roomTimings.begin(), part.roomTimings.end());
+        if (result.error.empty()) result.error = part.error;
+    }
+
+    // best-effort applies save whatever was written, transactional ones only a complete apply
+    if (database && !(failed && mode == SceneApplyMode::TRANSACTIONAL)) {
+        std::vector<std::pair<const Device*, int>> rows;
+        for (const auto& out : outcomes)
+            for (const auto& undo : out.undo) rows.emplace_back(undo.device, undo.roomId);
+        if (!database->saveDevices(rows)) {
+            result.error = "Scene could not be saved to the database.";
+            failed = mode == SceneApplyMode::TRANSACTIONAL;
         }
     }
-    else { // HOUSE
-        for (auto& pair : rooms) {
-            auto room = pair.second;
-            auto deviceList = room->getDevices(); // cache locally
-            for (const auto& sds : sceneCopy.deviceStates) {
-                for (auto& devicePtr : deviceList) {
-                    if (!devicePtr) continue;
-                    if (devicePtr->getId() == sds.deviceId) {
-                        devicePtr->setState(sds.state);
-                        break;
-                    }
+
+    if (failed && mode == SceneApplyMode::TRANSACTIONAL) {
+        rollback(outcomes);
+        result.rolledBack = true;
+        result.changed.clear();
+    } else {
+        result.applied = true;
+    }
+    result.milliseconds =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+uint64_t SceneManager::stripeBit(int deviceId) {
+    int stripe = deviceId % DEVICE_STRIPES;
+    return uint64_t(1) << (stripe < 0 ? stripe + DEVICE_STRIPES : stripe);
+}
+
+std::shared_ptr<ScenePlan> SceneManager::slicePlan(const ScenePlan& plan, size_t begin, size_t end) {
+    auto slice = std::make_shared<ScenePlan>();
+    slice->generation = plan.generation;
+    slice->steps.assign(plan.steps.begin() + begin, plan.steps.begin() + end);
+    for (const auto& range : plan.rooms) {
+        size_t b = std::max(range.begin, begin), e = std::min(range.end, end);
+        if (b < e) slice->rooms.push_back({range.room, b - begin, e - begin});
+    }
+    for (const auto& step : slice->steps) slice->stripeMask |= stripeBit(step.device->getId());
+    return slice;
+}
+
+std::vector<std::shared_ptr<const ScenePlan>> SceneManager::transitionSteps(const ScenePlan& plan,
+                                                                            const SceneTransition& transition) const {
+    std::vector<std::shared_ptr<const ScenePlan>> steps;
+    if (plan.steps.empty()) return steps;
+    switch (transition.mode) {
+    case SceneTransitionMode::STAGGERED: {
+        size_t perStep = std::max<size_t>(transition.devicesPerStep, 1);
+        for (size_t begin = 0; begin < plan.steps.size(); begin += perStep)
+            steps.push_back(slicePlan(plan, begin, std::min(begin + perStep, plan.steps.size())));
+        break;
+    }
+    case SceneTransitionMode::BY_ROOM: {
+        // plans group rooms by address; order them by id, devices without a room last
+        std::vector<const ScenePlan::RoomRange*> ranges;
+        for (const auto& range : plan.rooms) ranges.push_back(&range);
+        std::stable_sort(ranges.begin(), ranges.end(), [](const ScenePlan::RoomRange* a, const ScenePlan::RoomRange* b) {
+            if (!a->room || !b->room) return a->room && !b->room;
+            return a->room->getId() < b->room->getId();
+        });
+        for (const auto* range : ranges) steps.push_back(slicePlan(plan, range->begin, range->end));
+        break;
+    }
+    case SceneTransitionMode::RAMP: {
+        // interpolate from the values the devices have now
+        int count = std::max(transition.rampSteps, 1);
+        std::vector<ScenePlanStep> from;
+        from.reserve(plan.steps.size());
+        for (const auto& step : plan.steps) {
+            ScenePlanStep current{step.device, step.device->getState(), step.attributeMask, {}};
+            for (int a = 0; a < MAX_DEVICE_ATTRIBUTES; ++a)
+                if (step.attributeMask & (1u << a)) current.attributes[a] = step.device->getAttributeAt(a);
+            from.push_back(std::move(current));
+        }
+        for (int k = 1; k <= count; ++k) {
+            auto ramp = std::make_shared<ScenePlan>(plan);
+            for (size_t i = 0; i < ramp->steps.size(); ++i) {
+                ScenePlanStep& step = ramp->steps[i];
+                const ScenePlanStep& start = from[i];
+                bool switchesOn = step.state == deviceTraits(step.device->getType()).onState;
+                if (!switchesOn && k < count) step.state = start.state;
+                for (int a = 0; a < MAX_DEVICE_ATTRIBUTES; ++a) {
+                    if (!(step.attributeMask & (1u << a))) continue;
+                    int64_t delta = int64_t(step.attributes[a]) - start.attributes[a];
+                    step.attributes[a] = static_cast<int32_t>(start.attributes[a] + delta * k / count);
                 }
             }
+            steps.push_back(std::move(ramp));
+        }
+        break;
+    }
+    case SceneTransitionMode::INSTANT:
+        break;
+    }
+    return steps;
+}
+
+std::vector<int> SceneManager::planDeviceIds(const ScenePlan& plan) {
+    std::vector<int> ids;
+    ids.reserve(plan.steps.size());
+    for (const auto& step : plan.steps) ids.push_back(step.device->getId());
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+void SceneManager::supersedeLocked(TransitionTable& table, const ScenePlan& plan) {
+    std::vector<int> ids; // built once some transition passes the stripe pre-filter
+    for (auto it = table.active.begin(); it != table.active.end();) {
+        Transition& transition = *it->second;
+        // different devices can share a stripe, so a stripe match alone proves nothing
+        if (!(transition.stripeMask & plan.stripeMask)) {
+            ++it;
+            continue;
         }
+        if (ids.empty()) ids = planDeviceIds(plan);
+        if (!sharesDevice(transition.deviceIds, ids)) {
+            ++it;
+            continue;
+        }
+        transition.scheduler->removeSchedule(transition.scheduleId);
+        it = table.active.erase(it);
+    }
+    table.activeCount = table.active.size();
+}
+
+void SceneManager::scheduleStep(const std::shared_ptr<TransitionTable>& table, Transition& transition) {
+    auto schedule = std::make_shared<Schedule>();
+    schedule->id = transition.scheduler->newScheduleId();
+    schedule->deviceId = -1;
+    schedule->scheduleType = "once";
+    // relative to the start, so slow steps don't push the later ones back
+    schedule->scheduledTime = transition.start + transition.interval * static_cast<long>(transition.next);
+    uint64_t id = transition.id;
+    schedule->action = [table, id]() { runTransitionStep(table, id); };
+    transition.scheduleId = schedule->id;
+    transition.scheduler->addSchedule(schedule);
+}
+
+void SceneManager::runTransitionStep(const std::shared_ptr<TransitionTable>& table, uint64_t id) {
+    std::lock_guard<std::mutex> lock(table->mutex);
+    auto it = table->active.find(id);
+    if (!table->owner || it == table->active.end()) return; // cancelled or superseded meanwhile
+    Transition& transition = *it->second;
+    table->owner->applyPlan(*transition.steps[transition.next], SceneApplyMode::BEST_EFFORT);
+    if (++transition.next < transition.steps.size()) {
+        scheduleStep(table, transition);
+    } else {
+        table->active.erase(it);
+        table->activeCount = table->active.size();
     }
+}
 
-    std::cout << "Scene '" << sceneName << "' applied successfully!" << std::endl;
+void SceneManager::setScheduler(std::shared_ptr<Scheduler> newScheduler) {
+    std::atomic_store(&scheduler, std::move(newScheduler));
+}
+
+SceneApplyResult SceneManager::applyScene(const std::string& sceneName, const SceneTransition& transition,
+                                          uint64_t* transitionId) {
+    if (transitionId) *transitionId = 0;
+    std::shared_ptr<Scheduler> driver = std::atomic_load(&scheduler);
+    if (transition.mode == SceneTransitionMode::INSTANT || !driver) return applyScene(sceneName);
+
+    SceneApplyResult result;
+    SceneHandle scene;
+    std::shared_ptr<const ScenePlan> plan;
+    if (!lookupForApply(sceneName, scene, plan)) {
+        result.error = "Scene '" + sceneName + "' not found.";
+        return result;
+    }
+    if (scene->type == SceneType::ROOM && rooms.find(scene->targetRoom) == rooms.end()) {
+        result.error = "Room " + scene->targetRoom + " not found.";
+        return result;
+    }
+
+    auto steps = transitionSteps(*plan, transition);
+    std::lock_guard<std::mutex> lock(transitions->mutex);
+    supersedeLocked(*transitions, *plan);
+    if (steps.empty()) {
+        result = applyPlan(*plan, SceneApplyMode::BEST_EFFORT);
+    } else {
+        result = applyPlan(*steps.front(), SceneApplyMode::BEST_EFFORT);
+    }
+    result.missing = plan->missing;
+    if (steps.size() <= 1) return result;
+
+    auto pending = std::make_shared<Transition>();
+    pending->id = transitions->nextId++;
+    pending->stripeMask = plan->stripeMask;
+    pending->deviceIds = planDeviceIds(*plan);
+    pending->steps = std::move(steps);
+    pending->start = std::chrono::system_clock::now();
+    pending->interval = transition.interval;
+    pending->scheduler = std::move(driver);
+    scheduleStep(transitions, *pending);
+    transitions->active.emplace(pending->id, pending);
+    transitions->activeCount = transitions->active.size();
+    if (transitionId) *transitionId = pending->id;
+    return result;
+}
+
+bool SceneManager::cancelTransition(uint64_t transitionId) {
+    std::lock_guard<std::mutex> lock(transitions->mutex);
+    auto it = transitions->active.find(transitionId);
+    if (it == transitions->active.end()) return false;
+    it->second->scheduler->removeSchedule(it->second->scheduleId);
+    transitions->active.erase(it);
+    transitions->activeCount = transitions->active.size();
     return true;
 }
 
+size_t SceneManager::cancelAllTransitions() {
+    std::lock_guard<std::mutex> lock(transitions->mutex);
+    size_t cancelled = transitions->active.size();
+    for (const auto& pair : transitions->active) pair.second->scheduler->removeSchedule(pair.second->scheduleId);
+    transitions->active.clear();
+    transitions->activeCount = 0;
+    return cancelled;
+}
+
+size_t SceneManager::activeTransitionCount() const {
+    return transitions->activeCount.load();
+}
+
 bool SceneManager::deleteScene(const std::string& sceneName) {
-    std::lock_guard<std::mutex> lock(scenesMutex);
-    for (auto it = scenes.begin(); it != scenes.end(); ++it) {
-        if (it->name == sceneName) {
-            scenes.erase(it);
+    {
+        std::lock_guard<std::mutex> lock(scenesMutex);
+        auto current = currentCatalog();
+        if (current->count(sceneName) > 0) {
+            for (const auto& pair : *current) {
+                const auto& includes = pair.second.scene->includes;
+                if (std::find(includes.begin(), includes.end(), sceneName) != includes.end()) {
+                    std::cerr << "Scene '" << sceneName << "' is included by '" << pair.first
+                              << "' and cannot be deleted." << std::endl;
+                    return false;
+                }
+            }
+            auto next = std::make_shared<SceneCatalog>(*current);
+            next->erase(sceneName);
+            std::atomic_store(&catalog, std::shared_ptr<const SceneCatalog>(std::move(next)));
             std::cout << "Scene '" << sceneName << "' deleted." << std::endl;
             return true;
         }
@@ -3,15 +3,27 @@
 
 #include <string>
 #include <vector>
+#include <iosfwd>
 #include <map>
+#include <unordered_map>
 #include <memory>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
 #include "Room.h"
 #include "Device.h"
+#include "DeviceRegistry.h"
+#include "ThreadPool.h"
+#include "DatabaseManager.h"
+#include "Scheduler.h"
 
 struct SceneDeviceState {
     int deviceId;
     DeviceState state;
+    uint8_t attributeMask = 0; // bit i set: attributes[i] is part of the scene
+    int32_t attributes[MAX_DEVICE_ATTRIBUTES] = {};
 };
 
 enum class SceneType { ROOM, HOUSE };
@@ -20,27 +32,289 @@ struct Scene {
     std::string name;
     SceneType type;
     std::string targetRoom;
-    std::vector<SceneDeviceState> deviceStates;
+    std::vector<std::string> includes;         // composed scenes, applied first and in order
+    std::vector<SceneDeviceState> deviceStates; // own entries; override included ones
 };
 
+// A scene resolved against the current devices: one flat array of steps,
+// grouped by owning room. Valid while the registry generation is unchanged.
+struct ScenePlanStep {
+    std::shared_ptr<Device> device;
+    DeviceState state;
+    uint8_t attributeMask;
+    int32_t attributes[MAX_DEVICE_ATTRIBUTES];
+};
+
+struct ScenePlan {
+    struct RoomRange {
+        std::shared_ptr<Room> room; // null for devices without a room
+        size_t begin, end;          // steps[begin, end)
+    };
+    uint64_t generation = 0;
+    uint64_t stripeMask = 0; // device lock stripes the steps fall into
+    std::vector<ScenePlanStep> steps;
+    std::vector<RoomRange> rooms;
+    std::vector<int> missing; // ids of scene entries that did not resolve to a device
+};
+
+struct RoomApplyTiming {
+    std::string room;     // empty for devices without a room
+    size_t devices;       // plan steps in this room
+    double milliseconds;  // time spent applying them
+};
+
+enum class SceneApplyMode {
+    BEST_EFFORT,  // apply what can be applied and report the rest
+    TRANSACTIONAL // all or nothing: a missing or failing device restores the prior states
+};
+
+// What applying a scene did; only devices that differed from the scene are written
+struct SceneApplyResult {
+    bool applied = false;   // false if the scene was not (or not completely) applied, see error
+    bool rolledBack = false; // a transactional apply failed and prior states were restored
+    std::string error;
+    std::vector<int> changed;   // state or an attribute was written
+    std::vector<int> unchanged; // already as the scene wants it
+    std::vector<int> missing;   // listed in the scene but no longer present
+    std::vector<int> failed;    // threw or did not reach the scene's state
+    std::vector<RoomApplyTiming> roomTimings; // in plan order
+    double milliseconds = 0;    // wall time of the whole apply
+};
+
+struct SceneImportStats {
+    size_t scenes = 0;   // scenes created or replaced
+    size_t devices = 0;  // device entries in them
+    size_t rejected = 0; // scenes refused by createScene
+    size_t skippedLines = 0;
+};
+
+enum class SceneTransitionMode {
+    INSTANT,   // every device at once
+    STAGGERED, // devicesPerStep devices per interval, room by room
+    BY_ROOM,   // one room per interval, in room id order
+    RAMP       // attributes move to their targets in rampSteps even steps; devices
+               // switch on at the first step and off at the last
+};
+
+struct SceneTransition {
+    SceneTransitionMode mode = SceneTransitionMode::INSTANT;
+    std::chrono::milliseconds interval{500}; // between steps
+    size_t devicesPerStep = 1;               // STAGGERED
+    int rampSteps = 10;                      // RAMP
+};
+
+// What captureScene snapshots. By default every device of the house with its
+// state and attributes.
+struct SceneCaptureOptions {
+    std::string room;                          // only this room's devices; makes a ROOM scene
+    std::function<bool(const Device&)> filter; // if set, only devices it accepts
+    bool attributes = true;                    // capture attribute values too (not sensor readings)
+    // If set, only devices whose current values differ from this scene are stored,
+    // and the new scene includes it, so applying it still restores the whole snapshot.
+    // A room capture needs a baseline scene of the same room.
+    std::string baseline;
+};
+
+// Scenes are immutable once stored; a handle stays valid (and unchanged) even if
+// the scene is deleted or replaced while someone is still applying it.
+using SceneHandle = std::shared_ptr<const Scene>;
+
 class SceneManager {
+public:
+    static const int DEVICE_STRIPES = 64;
+
 private:
-    std::vector<Scene> scenes;
+    // what a scene step overwrote, for rollback and persistence
+    struct UndoEntry {
+        Device* device; // kept alive by the plan
+        int roomId;
+        bool stateWritten;
+        DeviceState state;
+        uint8_t attributeMask; // attributes that were written
+        int32_t attributes[MAX_DEVICE_ATTRIBUTES];
+    };
+    struct RangeOutcome {
+        SceneApplyResult result;
+        std::vector<UndoEntry> undo;
+        bool failed = false;
+    };
+
+    // Cached plan of one scene. Shared by every catalog version that holds the
+    // scene, so refreshing a stale plan doesn't need a new catalog.
+    struct PlanCache {
+        std::shared_ptr<const ScenePlan> plan; // std::atomic_load / std::atomic_store only
+    };
+    struct SceneEntry {
+        SceneHandle scene;
+        uint64_t order; // creation sequence, for listing
+        std::shared_ptr<PlanCache> planCache;
+    };
+    using SceneCatalog = std::unordered_map<std::string, SceneEntry>; // by scene name
+    // scene name -> names (catalog keys) of the scenes that include it
+    using IncludeIndex = std::unordered_map<std::string, std::vector<const std::string*>>;
+
+    // Copy-on-write: readers std::atomic_load the current catalog and never lock;
+    // writers copy it under scenesMutex, change the copy and std::atomic_store it.
+    std::shared_ptr<const SceneCatalog> catalog;
+    uint64_t nextOrder = 0;
     std::map<std::string, std::shared_ptr<Room>> rooms;
-    mutable std::mutex scenesMutex; // protect scenes vector
+    std::shared_ptr<DeviceRegistry> registry;
+    std::mutex scenesMutex; // serialises catalog writers
+    std::shared_ptr<ThreadPool> applyPool; // null: rooms are applied sequentially; atomic access
+    std::shared_ptr<DatabaseManager> database; // where applied scenes are persisted, optional
+    // Scene applies claim the stripes (device id % DEVICE_STRIPES) of the devices
+    // they touch, all at once, so two applies never interleave on the same device
+    std::mutex stripeMutex;
+    std::condition_variable stripesReleased;
+    uint64_t busyStripes = 0;
 
-    // helper to find scene by name; returns index or -1 if not found
-    int findSceneIndex(const std::string& sceneName) const;
+    std::shared_ptr<const SceneCatalog> currentCatalog() const { return std::atomic_load(&catalog); }
+    // Stores scenes, replacing ones with the same name, as one new catalog version.
+    // Scenes whose includes are unknown or would form a cycle are refused (with a
+    // message in errors); returns how many were stored and adds their device
+    // entries to storedDevices.
+    size_t storeScenes(std::vector<Scene>&& batch, std::vector<std::string>* errors = nullptr,
+                       size_t* storedDevices = nullptr);
+    bool storeScene(Scene&& scene, std::string* error = nullptr);
+    bool validateScene(const Scene& scene, std::string* error) const;
+    // levels of includes a scene may have below it
+    static constexpr int MAX_INCLUDE_DEPTH = 32;
+    // includes must exist, must not lead back to the scene and, with the scene
+    // in place, no chain of includes may be deeper than MAX_INCLUDE_DEPTH.
+    // includedBy indexes catalog; it may be null if the scene is not in catalog yet.
+    static bool checkIncludes(const SceneCatalog& catalog, const IncludeIndex* includedBy,
+                              const Scene& scene, std::string& error);
+    // composites whose constituents changed get an empty plan cache
+    static void invalidateDependents(SceneCatalog& catalog, const std::vector<std::string>& changed);
+    // effective device states of a scene with its includes resolved (later entries win)
+    static void flattenScene(const SceneCatalog& catalog, const Scene& scene,
+                             std::vector<SceneDeviceState>& out, std::unordered_map<int, size_t>& index,
+                             int depth = 0);
+    std::shared_ptr<const ScenePlan> compilePlan(const Scene& scene, const SceneCatalog& catalog) const;
+    // the scene and an up-to-date plan for it; false if there is no such scene
+    bool lookupForApply(const std::string& sceneName, SceneHandle& scene,
+                        std::shared_ptr<const ScenePlan>& plan);
+    // applies steps [range.begin, range.end) of a plan, recording into out;
+    // a transactional apply stops at the first failing device
+    static void applyRoomRange(const ScenePlan& plan, const ScenePlan::RoomRange& range,
+                               SceneApplyMode mode, RangeOutcome& out);
+    static void rollback(std::vector<RangeOutcome>& outcomes);
+    void acquireStripes(uint64_t mask); // blocks until none of them is claimed
+    void releaseStripes(uint64_t mask);
+    static uint64_t stripeBit(int deviceId);
+    // claims the plan's stripes, applies it and persists what changed
+    SceneApplyResult applyPlan(const ScenePlan& plan, SceneApplyMode mode);
+
+    // A timed transition: the plan cut into steps, the first applied when it
+    // starts, each later one by a "once" schedule set when the previous ran.
+    struct Transition {
+        uint64_t id;
+        uint64_t stripeMask;        // of all steps; pre-filter for the exact check below
+        std::vector<int> deviceIds; // sorted ids of all steps; a newer apply touching one supersedes it
+        std::vector<std::shared_ptr<const ScenePlan>> steps;
+        size_t next = 1;
+        std::chrono::system_clock::time_point start; // step i is due at start + i * interval
+        std::chrono::milliseconds interval;
+        std::shared_ptr<Scheduler> scheduler;
+        int scheduleId = 0; // of the pending step
+    };
+    // Shared with pending schedules, which may run after the manager is gone
+    // (owner is then null). mutex is held while a step applies, so cancelling
+    // or superseding never overlaps a running step.
+    struct TransitionTable {
+        std::mutex mutex;
+        SceneManager* owner = nullptr;
+        uint64_t nextId = 1;
+        std::unordered_map<uint64_t, std::shared_ptr<Transition>> active;
+        std::atomic<size_t> activeCount{0}; // lets applies skip the lock when idle
+    };
+    std::shared_ptr<TransitionTable> transitions;
+    std::shared_ptr<Scheduler> scheduler; // drives transitions; atomic access
+
+    std::vector<std::shared_ptr<const ScenePlan>> transitionSteps(const ScenePlan& plan,
+                                                                  const SceneTransition& transition) const;
+    static std::shared_ptr<ScenePlan> slicePlan(const ScenePlan& plan, size_t begin, size_t end);
+    static std::vector<int> planDeviceIds(const ScenePlan& plan); // sorted
+    // cancels transitions sharing a device with plan; table mutex must be held
+    static void supersedeLocked(TransitionTable& table, const ScenePlan& plan);
+    static void scheduleStep(const std::shared_ptr<TransitionTable>& table, Transition& transition);
+    static void runTransitionStep(const std::shared_ptr<TransitionTable>& table, uint64_t id);
+    // asks the user for a device's target state; false if skipped or invalid
+    bool promptDeviceState(const Device& device, SceneDeviceState& out) const;
 
 public:
-    SceneManager(const std::map<std::string, std::shared_ptr<Room>>& rooms);
+    SceneManager(const std::map<std::string, std::shared_ptr<Room>>& rooms,
+                 std::shared_ptr<DeviceRegistry> registry,
+                 std::shared_ptr<DatabaseManager> database = nullptr);
+    ~SceneManager(); // cancels transitions still in flight
+    SceneManager(const SceneManager&) = delete;
+    SceneManager& operator=(const SceneManager&) = delete;
 
     void createRoomScene(const std::string& sceneName, const std::string& roomName);
     void createHouseScene(const std::string& sceneName);
 
+    // Non-interactive creation. ROOM scenes need an existing room (roomName is
+    // ignored for HOUSE scenes); states must be valid for devices that exist,
+    // unknown ids are kept and reported as missing when applied. Replaces a
+    // scene with the same name. On failure returns false and fills error.
+    bool createScene(const std::string& sceneName, SceneType type, const std::string& roomName,
+                     std::vector<SceneDeviceState> deviceStates, std::string* error = nullptr);
+
+    // Save the current state of the devices selected by options as a scene, in one
+    // pass over the rooms. Replaces a scene with the same name. Returns false and
+    // fills error if the room or baseline is unknown.
+    bool captureScene(const std::string& sceneName, const SceneCaptureOptions& options = SceneCaptureOptions(),
+                      std::string* error = nullptr);
+
+    // Composition: the scene applies the included scenes in order, then its own
+    // overrides; a device listed more than once takes its last state, attributes
+    // are merged. Includes must exist, must not lead back to the scene and may be
+    // nested at most 32 levels deep.
+    // Apply uses one flattened plan, rebuilt only when a constituent changes.
+    bool composeScene(const std::string& sceneName, SceneType type, const std::string& roomName,
+                      std::vector<std::string> includes, std::vector<SceneDeviceState> overrides,
+                      std::string* error = nullptr);
+
+    // Streaming CSV import/export, one device entry per line:
+    //   <scene>,<HOUSE|ROOM>,<room>,<device id>,<state>,<attr0>,<attr1>
+    // Lines of a scene must be consecutive; empty attribute fields are not part of
+    // the scene, a line with an empty device id declares a scene without devices,
+    // and "include" in the device id column includes the scene named in the state column.
+    // Names cannot contain commas. Blank lines and lines starting with '#' are ignored.
+    // Parsed scenes are stored in batches of 256, so at most one batch is held in
+    // memory at a time.
+    SceneImportStats importScenes(std::istream& in);
+    size_t exportScenes(std::ostream& out) const; // returns the number of scenes written
+
+    // Number of rooms a scene may apply at the same time (default 1 = sequential).
+    // With a higher cap, each room's part of a scene runs on a shared thread pool.
+    void setApplyConcurrency(size_t maxRooms);
+    size_t getApplyConcurrency() const;
+
     void listSceneNames() const;
+    // nullptr if there is no scene with that name
+    SceneHandle findScene(const std::string& sceneName) const;
+
+    // Devices that change are saved in one database transaction when a
+    // database is attached. In TRANSACTIONAL mode a failed save is rolled back too.
+    // Supersedes in-flight transitions that touch the same devices.
+    SceneApplyResult applyScene(const std::string& sceneName,
+                                SceneApplyMode mode = SceneApplyMode::BEST_EFFORT);
 
-    bool applyScene(const std::string& sceneName);
+    // Scheduler whose loop runs the steps of timed transitions; without one,
+    // transitions apply instantly.
+    void setScheduler(std::shared_ptr<Scheduler> scheduler);
+    // Apply with a timed transition (best effort). The first step is applied
+    // before returning and its result returned; the rest follow one per interval.
+    // A transition sharing devices with it is cancelled first. transitionId gets
+    // the id for cancelTransition, or 0 if nothing is left to run.
+    SceneApplyResult applyScene(const std::string& sceneName, const SceneTransition& transition,
+                                uint64_t* transitionId = nullptr);
+    // stops before the next step; devices keep the values already applied
+    bool cancelTransition(uint64_t transitionId);
+    size_t cancelAllTransitions();
+    size_t activeTransitionCount() const;
+    // refuses to delete a scene that other scenes include
     bool deleteScene(const std::string& sceneName);
 };
 
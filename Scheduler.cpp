@@ -5,11 +5,17 @@
 #include <thread>
 
 void Scheduler::addSchedule(std::shared_ptr<Schedule> schedule) {
-    schedules.push_back(schedule);
-    std::cout << "Schedule added for device ID: " << schedule->deviceId << std::endl;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        schedules.push_back(schedule);
+    }
+    wake.notify_all(); // it may be due before the loop would wake up
+    if (schedule->deviceId >= 0)
+        std::cout << "Schedule added for device ID: " << schedule->deviceId << std::endl;
 }
 
 void Scheduler::removeSchedule(int scheduleId) {
+    std::lock_guard<std::mutex> lock(mutex);
     schedules.erase(std::remove_if(schedules.begin(), schedules.end(),
         [scheduleId](const std::shared_ptr<Schedule>& sch) {
             return sch->id == scheduleId;
@@ -19,25 +25,53 @@ void Scheduler::removeSchedule(int scheduleId) {
 void Scheduler::checkAndRunSchedules() {
     auto now = std::chrono::system_clock::now();
 
-    for (auto& schedule : schedules) {
-        if (now >= schedule->scheduledTime) {
-            schedule->action();
-            std::cout << "Schedule executed for device ID: " << schedule->deviceId << std::endl;
-
+    std::vector<std::shared_ptr<Schedule>> due;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = schedules.begin(); it != schedules.end();) {
+            auto& schedule = *it;
+            if (now < schedule->scheduledTime) {
+                ++it;
+                continue;
+            }
+            due.push_back(schedule);
             if (schedule->scheduleType == "once") {
-                removeSchedule(schedule->id);
+                it = schedules.erase(it);
+                continue;
             } else if (schedule->scheduleType == "daily") {
                 schedule->scheduledTime += std::chrono::hours(24);
             } else if (schedule->scheduleType == "weekly") {
                 schedule->scheduledTime += std::chrono::hours(24 * 7);
             }
+            ++it;
         }
     }
+
+    for (auto& schedule : due) {
+        schedule->action();
+        if (schedule->deviceId >= 0)
+            std::cout << "Schedule executed for device ID: " << schedule->deviceId << std::endl;
+    }
 }
 
 void Scheduler::runLoop() {
-    while (true) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        lock.unlock();
         checkAndRunSchedules();
-        std::this_thread::sleep_for(std::chrono::seconds(30)); // check every 30 seconds
+        lock.lock();
+
+        auto next = std::chrono::system_clock::now() + std::chrono::seconds(30); // check at least every 30 seconds
+        for (const auto& schedule : schedules)
+            next = std::min(next, schedule->scheduledTime);
+        if (!stopping) wake.wait_until(lock, next);
+    }
+}
+
+void Scheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
     }
+    wake.notify_all();
 }
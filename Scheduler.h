@@ -6,11 +6,14 @@
 #include <vector>
 #include <chrono>
 #include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 #include "Device.h"
 
 struct Schedule {
     int id;
-    int deviceId;
+    int deviceId; // -1 for internal schedules (scene transitions), which run quietly
     std::string scheduleType; // "daily", "weekly", "once"
     std::chrono::system_clock::time_point scheduledTime;
     std::function<void()> action; // Callback that performs the scheduled action
@@ -19,14 +22,24 @@ struct Schedule {
 class Scheduler {
 private:
     std::vector<std::shared_ptr<Schedule>> schedules;
+    std::mutex mutex;             // guards schedules and stopping
+    std::condition_variable wake; // a schedule was added, or stop()
+    bool stopping = false;
+    std::atomic<int> lastInternalId{0};
 
 public:
     Scheduler() = default;
 
     void addSchedule(std::shared_ptr<Schedule> schedule);
     void removeSchedule(int scheduleId);
+    // runs due actions outside the lock, so an action may add or remove schedules
     void checkAndRunSchedules();
+    // sleeps until the next schedule is due (at most 30 s) or one is added; returns after stop()
     void runLoop();
+    void stop();
+
+    // ids for internal schedules; negative, so they never clash with ids picked by callers
+    int newScheduleId() { return --lastInternalId; }
 };
 
 #endif // SCHEDULER_H
\ No newline at end of file
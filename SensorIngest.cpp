@@ -0,0 +1,147 @@
+#include "SensorIngest.h"
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <algorithm>
+
+SensorIngestPipeline::SensorIngestPipeline(RuleEngine& engine, size_t ringCapacity, size_t batchSize)
+    : engine(engine), ringCapacity(ringCapacity), batch(batchSize > 0 ? batchSize : 1) {}
+
+int SensorIngestPipeline::addSource(const std::string& name, bool sharedProducers, OverflowPolicy policy) {
+    auto src = std::make_unique<Source>();
+    src->name = name;
+    src->policy = policy;
+    if (sharedProducers)
+        src->mpsc = std::make_unique<MpscRing<SensorReading>>(ringCapacity);
+    else
+        src->spsc = std::make_unique<SpscRing<SensorReading>>(ringCapacity);
+    sources.push_back(std::move(src));
+    return static_cast<int>(sources.size()) - 1;
+}
+
+bool SensorIngestPipeline::push(int sourceId, const SensorReading& reading) {
+    Source& src = *sources[static_cast<size_t>(sourceId)];
+    if (src.tryPush(reading)) {
+        src.pushed.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    if (src.policy == OverflowPolicy::DROP) {
+        src.dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    src.blocked.fetch_add(1, std::memory_order_relaxed);
+    while (!src.tryPush(reading)) std::this_thread::yield();
+    src.pushed.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+size_t SensorIngestPipeline::drain() {
+    size_t total = 0;
+    for (auto& src : sources) {
+        size_t n;
+        // bound the work per source so one busy producer cannot starve the others
+        size_t budget = ringCapacity;
+        while (budget > 0 && (n = src->popBatch(batch.data(), std::min(batch.size(), budget))) > 0) {
+            engine.ingest(batch.data(), n);
+            src->consumed += n;
+            total += n;
+            budget -= n;
+        }
+    }
+    return total;
+}
+
+void SensorIngestPipeline::runConsumer(const std::atomic<bool>& stop) {
+    while (!stop.load(std::memory_order_acquire)) {
+        if (drain() == 0)
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    drain(); // pick up whatever was pushed before stop
+}
+
+std::vector<IngestSourceStats> SensorIngestPipeline::getStats() const {
+    std::vector<IngestSourceStats> out;
+    for (const auto& src : sources) {
+        IngestSourceStats st;
+        st.name = src->name;
+        st.pushed = src->pushed.load(std::memory_order_relaxed);
+        st.dropped = src->dropped.load(std::memory_order_relaxed);
+        st.blocked = src->blocked.load(std::memory_order_relaxed);
+        st.consumed = src->consumed;
+        out.push_back(st);
+    }
+    return out;
+}
+
+void SensorIngestPipeline::printStats() const {
+    std::cout << "\nSensor Ingestion Stats:\n";
+    for (const auto& st : getStats()) {
+        std::cout << "  • " << st.name << " | pushed: " << st.pushed << " | dropped: " << st.dropped
+                  << " | blocked: " << st.blocked << " | consumed: " << st.consumed << "\n";
+    }
+}
+
+bool loadReplayFile(const std::string& path, RuleEngine& engine, std::vector<SensorReading>& out) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Replay file not found: " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    size_t lineNo = 0;
+    while (std::getline(file, line)) {
+        ++lineNo;
+        if (line.empty() || line[0] == '#') continue;
+
+        size_t c1 = line.find(',');
+        size_t c2 = c1 == std::string::npos ? c1 : line.find(',', c1 + 1);
+        size_t c3 = c2 == std::string::npos ? c2 : line.find(',', c2 + 1);
+        if (c3 == std::string::npos) {
+            std::cerr << "Skipping malformed replay line " << lineNo << std::endl;
+            continue;
+        }
+
+        std::string room = line.substr(c1 + 1, c2 - c1 - 1);
+        std::string kind = line.substr(c2 + 1, c3 - c2 - 1);
+        SignalKind signalKind;
+        if (kind == "temperature") signalKind = SignalKind::TEMPERATURE;
+        else if (kind == "motion") signalKind = SignalKind::MOTION;
+        else {
+            std::cerr << "Unknown signal '" << kind << "' on replay line " << lineNo << std::endl;
+            continue;
+        }
+
+        SensorReading r;
+        char* end = nullptr;
+        r.timestampUs = std::strtoll(line.c_str(), &end, 10);
+        if (end != line.c_str() + c1 || c1 == 0 || r.timestampUs < 0) {
+            std::cerr << "Bad timestamp on replay line " << lineNo << std::endl;
+            continue;
+        }
+        r.signal = engine.signalId(engine.registerRoom(room), signalKind);
+        r.value = std::strtof(line.c_str() + c3 + 1, nullptr);
+        out.push_back(r);
+    }
+    return true;
+}
+
+size_t replayReadings(SensorIngestPipeline& pipeline, int sourceId,
+                      const std::vector<SensorReading>& readings, bool realTime) {
+    if (readings.empty()) return 0;
+
+    auto start = std::chrono::steady_clock::now();
+    long long firstTs = readings.front().timestampUs;
+    size_t accepted = 0;
+    for (const auto& r : readings) {
+        if (realTime) {
+            auto due = start + std::chrono::microseconds(r.timestampUs - firstTs);
+            if (due > std::chrono::steady_clock::now()) std::this_thread::sleep_until(due);
+        }
+        if (pipeline.push(sourceId, r)) ++accepted;
+    }
+    return accepted;
+}
@@ -0,0 +1,81 @@
+#ifndef SENSORINGEST_H
+#define SENSORINGEST_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include "RingBuffer.h"
+#include "RuleEngine.h"
+
+// What a producer does when its ring is full
+enum class OverflowPolicy {
+    DROP,  // reject the reading and count it as dropped
+    BLOCK  // spin/yield until the consumer frees a slot (back-pressure)
+};
+
+struct IngestSourceStats {
+    std::string name;
+    unsigned long long pushed = 0;
+    unsigned long long dropped = 0;
+    unsigned long long blocked = 0; // pushes that had to wait for space
+    unsigned long long consumed = 0;
+};
+
+// Moves sensor readings from producer threads into the RuleEngine.
+// Producers push into a per-source ring; one consumer thread drains all rings
+// in batches. Sources must be added before producers start, and drain() must run
+// on the thread that owns the RuleEngine (the one calling applyRules).
+class SensorIngestPipeline {
+private:
+    struct Source {
+        std::string name;
+        OverflowPolicy policy;
+        std::unique_ptr<SpscRing<SensorReading>> spsc; // exactly one of these is set
+        std::unique_ptr<MpscRing<SensorReading>> mpsc;
+        std::atomic<unsigned long long> pushed{0};
+        std::atomic<unsigned long long> dropped{0};
+        std::atomic<unsigned long long> blocked{0};
+        unsigned long long consumed = 0; // consumer only
+
+        bool tryPush(const SensorReading& r) { return spsc ? spsc->tryPush(r) : mpsc->tryPush(r); }
+        size_t popBatch(SensorReading* out, size_t n) {
+            return spsc ? spsc->popBatch(out, n) : mpsc->popBatch(out, n);
+        }
+    };
+
+    RuleEngine& engine;
+    size_t ringCapacity;
+    std::vector<std::unique_ptr<Source>> sources;
+    std::vector<SensorReading> batch; // consumer scratch buffer
+
+public:
+    explicit SensorIngestPipeline(RuleEngine& engine, size_t ringCapacity = 8192, size_t batchSize = 1024);
+
+    // sharedProducers = true gives the source an MPSC ring, otherwise SPSC
+    int addSource(const std::string& name, bool sharedProducers = false,
+                  OverflowPolicy policy = OverflowPolicy::DROP);
+
+    // producer side; returns false if the reading was dropped
+    bool push(int sourceId, const SensorReading& reading);
+
+    // consumer side; drains every source once, returns the number of readings applied
+    size_t drain();
+    // drain until stop is set, sleeping briefly when all rings are empty
+    void runConsumer(const std::atomic<bool>& stop);
+
+    std::vector<IngestSourceStats> getStats() const;
+    void printStats() const;
+};
+
+// Replay of recorded readings. File format, one reading per line:
+//   <timestamp_us>,<room name>,<temperature|motion>,<value>
+// Rooms are interned into the engine while loading, so load before starting producers.
+bool loadReplayFile(const std::string& path, RuleEngine& engine, std::vector<SensorReading>& out);
+
+// Push readings into a source as fast as the pipeline accepts them, or paced by
+// their timestamps when realTime is true. Returns the number of accepted readings.
+size_t replayReadings(SensorIngestPipeline& pipeline, int sourceId,
+                      const std::vector<SensorReading>& readings, bool realTime = false);
+
+#endif // SENSORINGEST_H
@@ -0,0 +1,75 @@
+#include "SignalWindow.h"
+
+SignalWindow::SignalWindow(int windowSeconds)
+    : windowSeconds(windowSeconds > 0 ? windowSeconds : 1) {
+    bucketUs = static_cast<long long>(this->windowSeconds) * 1000000LL / BUCKETS;
+    if (bucketUs <= 0) bucketUs = 1;
+}
+
+void SignalWindow::add(float value, long long timestampUs) {
+    if (timestampUs < 0) return; // epochs below 0 would index outside the buckets
+    long long epoch = timestampUs / bucketUs;
+    if (epoch < latestEpoch - (BUCKETS - 1)) return; // older than the whole window
+
+    Bucket &b = buckets[static_cast<std::size_t>(epoch % BUCKETS)];
+    if (b.epoch != epoch) {
+        // slot still holds an expired slice: recycle it
+        b.epoch = epoch;
+        b.sum = value;
+        b.count = 1;
+        b.min = value;
+        b.max = value;
+        b.first = value;
+        b.firstTs = timestampUs;
+    } else {
+        b.sum += value;
+        b.count++;
+        if (value < b.min) b.min = value;
+        if (value > b.max) b.max = value;
+        if (timestampUs < b.firstTs) {
+            b.first = value;
+            b.firstTs = timestampUs;
+        }
+    }
+
+    if (timestampUs >= latestTs || latestEpoch < 0) {
+        latest = value;
+        latestTs = timestampUs;
+        latestEpoch = epoch;
+    }
+}
+
+bool SignalWindow::query(SignalAggregate agg, float &out) const {
+    if (empty()) return false;
+    if (agg == SignalAggregate::LATEST) {
+        out = latest;
+        return true;
+    }
+
+    long long oldestEpoch = latestEpoch - (BUCKETS - 1);
+    double sum = 0.0;
+    long long count = 0;
+    float mn = latest, mx = latest;
+    const Bucket *oldest = nullptr;
+    for (const auto &b : buckets) {
+        if (b.count == 0 || b.epoch < oldestEpoch || b.epoch > latestEpoch) continue;
+        sum += b.sum;
+        count += b.count;
+        if (b.min < mn) mn = b.min;
+        if (b.max > mx) mx = b.max;
+        if (!oldest || b.firstTs < oldest->firstTs) oldest = &b;
+    }
+
+    switch (agg) {
+        case SignalAggregate::MEAN: out = static_cast<float>(sum / static_cast<double>(count)); break;
+        case SignalAggregate::MIN: out = mn; break;
+        case SignalAggregate::MAX: out = mx; break;
+        case SignalAggregate::RATE: {
+            long long dt = latestTs - oldest->firstTs;
+            out = dt > 0 ? static_cast<float>((latest - oldest->first) * 1e6 / static_cast<double>(dt)) : 0.0f;
+            break;
+        }
+        default: out = latest; break;
+    }
+    return true;
+}
@@ -0,0 +1,53 @@
+#ifndef SIGNALWINDOW_H
+#define SIGNALWINDOW_H
+
+#include <array>
+#include <cstddef>
+
+enum class SignalAggregate {
+    LATEST,
+    MEAN,
+    MIN,
+    MAX,
+    RATE // change per second across the window
+};
+
+// Sliding-window aggregates for one signal with fixed memory.
+// The window is split into BUCKETS time slices; a reading updates one bucket in
+// O(1) and a query scans the fixed set of buckets. The window ends at the newest
+// reading of the signal, so replayed data with its own timeline works as well.
+class SignalWindow {
+public:
+    static const int BUCKETS = 24;
+
+private:
+    struct Bucket {
+        long long epoch = -1; // timestamp / bucketUs, -1 when unused
+        float sum = 0.0f;
+        int count = 0;
+        float min = 0.0f;
+        float max = 0.0f;
+        float first = 0.0f;
+        long long firstTs = 0;
+    };
+
+    int windowSeconds;
+    long long bucketUs;
+    std::array<Bucket, BUCKETS> buckets;
+    float latest = 0.0f;
+    long long latestTs = 0;
+    long long latestEpoch = -1;
+
+public:
+    explicit SignalWindow(int windowSeconds);
+
+    int getWindowSeconds() const { return windowSeconds; }
+    bool empty() const { return latestEpoch < 0; }
+
+    // readings with a negative timestamp are ignored
+    void add(float value, long long timestampUs);
+    // returns false if the window holds no readings
+    bool query(SignalAggregate agg, float &out) const;
+};
+
+#endif // SIGNALWINDOW_H
@@ -0,0 +1,38 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads. The number of workers is the concurrency
+// cap: at most that many tasks run at the same time.
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    void workerLoop();
+
+public:
+    explicit ThreadPool(size_t threads);
+    ~ThreadPool(); // runs the tasks already queued, then joins the workers
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers.size(); }
+    void submit(std::function<void()> task);
+
+    // Run fn(0) .. fn(count - 1) on the pool and return once all have finished.
+    // Must not be called from a pool thread.
+    void parallelFor(size_t count, const std::function<void(size_t)>& fn);
+};
+
+#endif // THREADPOOL_H
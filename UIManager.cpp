@@ -2,6 +2,7 @@
 #include "Scheduler.h"
 #include <iostream>
 #include <iomanip>
+#include <fstream>
 #include <limits>
 #include <string>
 #include <algorithm>
@@ -27,16 +28,20 @@
 UIManager::UIManager(std::shared_ptr<DatabaseManager> dbManager)
     : dbManager(dbManager) {
     rooms.clear();
-    auto roomList = dbManager->loadRooms();
+    arena = std::make_shared<HomeArena>();
+    registry = std::make_shared<DeviceRegistry>();
+    auto roomList = dbManager->loadRooms(arena);
     for (const auto& room : roomList) {
-        rooms[room->getName()] = room;
-        auto devices = dbManager->loadDevices(room->getId());
+        rooms[std::string(room->getName())] = room;
+        room->attachRegistry(registry);
+        auto devices = dbManager->loadDevices(room->getId(), arena);
         for (auto& dev : devices) {
             room->addDevice(dev);
         }
     }
     // Ensure sceneManager is initialized AFTER rooms is populated
-    sceneManager = std::make_shared<SceneManager>(rooms);
+    sceneManager = std::make_shared<SceneManager>(rooms, registry, dbManager);
+    sceneManager->setApplyConcurrency(4);
 }
 
 void UIManager::initialize() {
@@ -51,10 +56,11 @@ void UIManager::run() {
         std::thread([this]() 
         {
             std::cout << "[Scheduler] Background thread started.\n";
-            scheduler->runLoop(); // runs forever, checks schedules every 30s
+            scheduler->runLoop(); // wakes when a schedule is due, at least every 30s
         }).detach();
         schedulerStarted = true;
     }
+    sceneManager->setScheduler(scheduler); // runs timed scene transitions
     while (true) {
         clearScreen();
         printMainMenu();
@@ -63,6 +69,8 @@ void UIManager::run() {
 
         if (input == "0") {
             std::cout << "Exiting Application.\n";
+            sceneManager->cancelAllTransitions();
+            scheduler->stop();
             break;
         } 
         else if (input == "S" || input == "s") {
@@ -94,7 +102,8 @@ void UIManager::printMainMenu() {
     int roomsPerLine = 3;
     int count = 0;
     for (const auto& pair : rooms) {
-        std::cout << "[" << idx++ << "] " << pair.first << "  ";
+        std::cout << "[" << idx++ << "] " << pair.first
+                  << " (" << pair.second->activeDeviceCount() << " on)  ";
         count++;
         if (count == roomsPerLine) {
             std::cout << std::endl;
@@ -102,37 +111,42 @@ void UIManager::printMainMenu() {
         }
     }
     if (count != 0) std::cout << std::endl;
+    std::cout << "\nActive: " << registry->activeDeviceCount() << "/" << registry->size() << " devices"
+              << "  (lights on: " << registry->countDevices(DeviceType::LIGHT, DeviceState::ON)
+              << ", fans on: " << registry->countDevices(DeviceType::FAN, DeviceState::ON) << ")\n";
     std::cout << "\n[0] Exit   [S] Smart Scenes/Modes\n";
 }
 
 void UIManager::roomMenu(std::shared_ptr<Room> room) {
     while (true) {
         clearScreen();
-        printHeader(room->getName() + " - DEVICES", 40);
+        printHeader(std::string(room->getName()) + " - DEVICES", 40);
         std::cout << std::left << std::setw(5) << "ID"
                   << std::setw(20) << "Device"
                   << std::setw(10) << "State"
+                  << std::setw(10) << "Level"
                   << std::setw(15) << "Last Action" << "\n";
-        std::cout << "-----------------------------------------------\n";
+        std::cout << "---------------------------------------------------------\n";
 
-        // cache device list locally so we don't iterate over a temporary repeatedly
-        auto deviceList = room->getDevices();
-        for (const auto& device : deviceList) {
-            if (!device) continue;
-            std::string stateText = device->getStateString();
-            std::string color = COLORRESET;
-            if (stateText == "ON") color = COLORGREEN;
-            else if (stateText == "OFF") color = COLORRED;
-            else if (stateText == "ACTIVE") color = COLORYELLOW;
-            else if (stateText == "INACTIVE") color = COLORCYAN;
+        // walk the room's devices in place, no copy of the device list
+        room->forEachDevice([](const Device& device) {
+            DeviceState state = device.getState();
+            const char* color = COLORRESET;
+            switch (state) {
+                case DeviceState::ON: color = COLORGREEN; break;
+                case DeviceState::OFF: color = COLORRED; break;
+                case DeviceState::ACTIVE: color = COLORYELLOW; break;
+                case DeviceState::INACTIVE: color = COLORCYAN; break;
+            }
 
-            std::cout << std::left << std::setw(5) << device->getId()
-                      << std::setw(20) << device->getName()
-                      << color << std::setw(10) << stateText << COLORRESET
+            std::cout << std::left << std::setw(5) << device.getId()
+                      << std::setw(20) << device.getName()
+                      << color << std::setw(10) << stateName(state) << COLORRESET
+                      << std::setw(10) << device.getAttributeAt(0)
                       << std::setw(15) << "Manual" << "\n";
-        }
+        });
 
-        std::cout << "-----------------------------------------------\n";
+        std::cout << "---------------------------------------------------------\n";
         std::cout << "[A] Toggle Device  [B] Add Schedule  [C] Apply Scene  [D] Return to Main Menu\n>>> Select Option: ";
         std::string choice;
         std::getline(std::cin, choice);
@@ -172,11 +186,8 @@ void UIManager::roomMenu(std::shared_ptr<Room> room) {
             std::getline(std::cin, timeStr);
             std::string actionType;
             auto deviceType = targetDevice->getType(); // keep it as enum, not string
-            if (deviceType == DeviceType::SENSOR)
-                std::cout << "Enter action (ACTIVE/INACTIVE): ";
-                
-            else
-                std::cout << "Enter action (ON/OFF): ";
+            const DeviceTypeTraits& traits = deviceTraits(deviceType);
+            std::cout << "Enter action (" << stateName(traits.onState) << "/" << stateName(traits.offState) << "): ";
             std::getline(std::cin, actionType);
             int hour, minute;
             if (sscanf(timeStr.c_str(), "%d:%d", &hour, &minute) != 2) {
@@ -198,18 +209,32 @@ void UIManager::roomMenu(std::shared_ptr<Room> room) {
             schedule->deviceId = deviceId;
             schedule->scheduleType = "once";
             schedule->scheduledTime = scheduledTime;
-            if (deviceType == DeviceType::SENSOR) {
-                if (actionType == "ACTIVE" || actionType == "active")
-                    schedule->action = [targetDevice]() { targetDevice->activate(); };
-                else
-                    schedule->action = [targetDevice]() { targetDevice->deactivate(); };
-            } 
-            else { 
-                if (actionType == "ON" || actionType == "on")
-                    schedule->action = [targetDevice]() { targetDevice->turnOn(); };
-                else
-                    schedule->action = [targetDevice]() { targetDevice->turnOff(); };
+            // anything but the "on" state name schedules the off state, as before
+            DeviceState target = traits.offState;
+            parseStateName(deviceType, actionType, target);
+            if (target == traits.onState) {
+                // optional attribute values (brightness, fan speed, setpoint) applied with the action
+                std::vector<std::pair<int, int32_t>> attributeValues;
+                for (int i = 0; i < MAX_DEVICE_ATTRIBUTES; ++i) {
+                    const AttributeSpec& spec = attributeSpec(deviceType, i);
+                    if (spec.attribute == DeviceAttribute::NONE || deviceType == DeviceType::SENSOR) continue;
+                    std::string value;
+                    std::cout << spec.label << " (blank to leave as is): ";
+                    std::getline(std::cin, value);
+                    try {
+                        if (!value.empty()) attributeValues.emplace_back(i, std::stoi(value));
+                    } catch (...) {
+                        std::cout << "Not a number, attribute skipped.\n";
+                    }
+                }
+                schedule->action = [targetDevice, target, attributeValues]() {
+                    targetDevice->apply(target, ChangeSource::SCHEDULE);
+                    for (const auto& av : attributeValues)
+                        targetDevice->setAttributeAt(av.first, av.second, ChangeSource::SCHEDULE);
+                };
             }
+            else
+                schedule->action = [targetDevice, target]() { targetDevice->apply(target, ChangeSource::SCHEDULE); };
             scheduler->addSchedule(schedule);
             std::cout << "Schedule added successfully!\n";
             pause();
@@ -218,12 +243,10 @@ void UIManager::roomMenu(std::shared_ptr<Room> room) {
             std::string sceneName;
             std::cout << "Enter scene name to apply: ";
             std::getline(std::cin, sceneName);
-            if (!sceneManager) {
+            if (!sceneManager)
                 std::cout << "Scene manager not available.\n";
-            } else if (!sceneManager->applyScene(sceneName))
-                std::cout << "Scene not found or failed to apply.\n";
             else
-                std::cout << "Scene applied.\n";
+                printSceneResult(sceneName, sceneManager->applyScene(sceneName));
             pause();
         }
         else {
@@ -251,7 +274,7 @@ void UIManager::sceneMenu() {
 
         sceneManager->listSceneNames();
 
-        std::cout << "\n[N] Create New Scene  [A] Apply Scene  [B] Back to Main Menu\nChoose Option: ";
+        std::cout << "\n[N] Create New Scene  [C] Capture Current State  [A] Apply Scene\n[I] Import  [E] Export  [X] Stop Transitions  [B] Back to Main Menu\nChoose Option: ";
         std::string input;
         std::getline(std::cin, input);
 
@@ -273,18 +296,77 @@ void UIManager::sceneMenu() {
             std::cout << "Scene created.\n";
             pause();
         }
+        else if (input == "C" || input == "c") {
+            std::string sceneName, roomName, baseline, error;
+            std::cout << "Enter new scene name: ";
+            std::getline(std::cin, sceneName);
+            std::cout << "Capture room (enter name) or 'HOUSE' for all rooms: ";
+            std::getline(std::cin, roomName);
+            std::cout << "Only store changes from scene (blank for a full snapshot): ";
+            std::getline(std::cin, baseline);
+
+            SceneCaptureOptions options;
+            if (roomName != "HOUSE" && roomName != "house") options.room = roomName;
+            options.baseline = baseline;
+            if (sceneManager->captureScene(sceneName, options, &error))
+                std::cout << "Scene '" << sceneName << "' captured.\n";
+            else
+                std::cout << "Capture failed: " << error << "\n";
+            pause();
+        }
         else if (input == "A" || input == "a") {
-            std::string sceneName;
+            std::string sceneName, mode;
             std::cout << "Enter scene name to apply: ";
             std::getline(std::cin, sceneName);
+            std::cout << "Transition: [Enter] instant, [S] staggered, [R] room by room, [F] fade: ";
+            std::getline(std::cin, mode);
 
-            if (sceneManager->applyScene(sceneName)) {
-                std::cout << "Scene applied successfully!\n";
+            SceneTransition transition;
+            if (mode == "S" || mode == "s") {
+                transition.mode = SceneTransitionMode::STAGGERED;
+                transition.devicesPerStep = 2;
+            } else if (mode == "R" || mode == "r") {
+                transition.mode = SceneTransitionMode::BY_ROOM;
+                transition.interval = std::chrono::seconds(1);
+            } else if (mode == "F" || mode == "f") {
+                transition.mode = SceneTransitionMode::RAMP;
+                transition.interval = std::chrono::milliseconds(300);
+            }
+            uint64_t transitionId = 0;
+            printSceneResult(sceneName, sceneManager->applyScene(sceneName, transition, &transitionId));
+            if (transitionId != 0)
+                std::cout << "Transition in progress; applying another scene to these devices stops it.\n";
+            pause();
+        }
+        else if (input == "X" || input == "x") {
+            std::cout << "Stopped " << sceneManager->cancelAllTransitions() << " transition(s).\n";
+            pause();
+        }
+        else if (input == "I" || input == "i") {
+            std::string path;
+            std::cout << "CSV file to import: ";
+            std::getline(std::cin, path);
+            std::ifstream file(path);
+            if (!file) {
+                std::cout << "Cannot open " << path << ".\n";
             } else {
-                std::cout << "Scene not found or failed to apply.\n";
+                SceneImportStats stats = sceneManager->importScenes(file);
+                std::cout << "Imported " << stats.scenes << " scenes (" << stats.devices << " device entries), "
+                          << stats.rejected << " rejected, " << stats.skippedLines << " lines skipped.\n";
             }
             pause();
         }
+        else if (input == "E" || input == "e") {
+            std::string path;
+            std::cout << "CSV file to export to: ";
+            std::getline(std::cin, path);
+            std::ofstream file(path);
+            if (!file)
+                std::cout << "Cannot write " << path << ".\n";
+            else
+                std::cout << "Exported " << sceneManager->exportScenes(file) << " scenes.\n";
+            pause();
+        }
         else {
             std::cout << "Invalid input.\n";
             pause();
@@ -292,6 +374,32 @@ void UIManager::sceneMenu() {
     }
 }
 
+void UIManager::printSceneResult(const std::string& sceneName, const SceneApplyResult& result) {
+    if (!result.applied) {
+        std::cout << COLORRED << result.error << COLORRESET << "\n";
+        if (result.rolledBack) std::cout << "No devices were changed (rolled back).\n";
+        return;
+    }
+    std::cout << "Scene '" << sceneName << "' applied: "
+              << COLORGREEN << result.changed.size() << " changed" << COLORRESET << ", "
+              << result.unchanged.size() << " already set";
+    if (!result.missing.empty()) {
+        std::cout << ", " << COLORYELLOW << result.missing.size() << " missing (IDs:";
+        for (int id : result.missing) std::cout << " " << id;
+        std::cout << ")" << COLORRESET;
+    }
+    std::cout << "\n";
+    if (!result.error.empty()) std::cout << COLORRED << result.error << COLORRESET << "\n";
+    if (result.roomTimings.size() > 1) {
+        auto slowest = std::max_element(result.roomTimings.begin(), result.roomTimings.end(),
+            [](const RoomApplyTiming& a, const RoomApplyTiming& b) { return a.milliseconds < b.milliseconds; });
+        std::cout << std::fixed << std::setprecision(2) << result.roomTimings.size() << " rooms in "
+                  << result.milliseconds << " ms (slowest: " << slowest->room << ", "
+                  << slowest->milliseconds << " ms)\n";
+        std::cout.unsetf(std::ios::floatfield);
+    }
+}
+
 void UIManager::clearScreen() {
 #ifdef _WIN32
     system("cls");
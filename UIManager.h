@@ -13,7 +13,9 @@
 class UIManager {
 private:
     std::shared_ptr<DatabaseManager> dbManager;
+    std::shared_ptr<HomeArena> arena; // rooms, devices and their names
     std::map<std::string, std::shared_ptr<Room>> rooms;
+    std::shared_ptr<DeviceRegistry> registry;
     std::shared_ptr<SceneManager> sceneManager;
     std::shared_ptr<Scheduler> scheduler;
 
@@ -26,6 +28,7 @@ private:
     void printColored(const std::string& text, int colorCode);
 
     void printMainMenu();
+    void printSceneResult(const std::string& sceneName, const SceneApplyResult& result);
     void roomMenu(std::shared_ptr<Room> room);
     void sceneMenu();
     void deviceControlMenu(const std::shared_ptr<Room>& room);
@@ -11,6 +11,8 @@ CREATE TABLE IF NOT EXISTS devices (
     type INTEGER NOT NULL,        -- Maps to DeviceType enum (0=LIGHT, 1=FAN, ...)
     state INTEGER NOT NULL,       -- Maps to DeviceState enum (0=OFF, 1=ON, ...)
     room_id INTEGER NOT NULL,
+    attr0 INTEGER,                -- first numeric attribute of the type (brightness, fan speed, setpoint, reading)
+    attr1 INTEGER,                -- second numeric attribute (AC fan speed), NULL if unused
     FOREIGN KEY (room_id) REFERENCES rooms(id) ON DELETE CASCADE
 );
 
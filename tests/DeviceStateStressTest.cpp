@@ -0,0 +1,116 @@
+// Concurrency stress test for device state and the state table's counters.
+// Writer threads toggle devices while a mover thread takes devices out of
+// their rooms and puts them into other rooms. Afterwards the incremental
+// counters must match a recount of the devices.
+//
+// Build from the repository root:
+//   g++ -std=c++17 -I. -pthread tests/DeviceStateStressTest.cpp Device.cpp Room.cpp DeviceRegistry.cpp DeviceStateTable.cpp ChangeBus.cpp HomeArena.cpp -o DeviceStateStressTest
+#include "Room.h"
+#include "DeviceRegistry.h"
+#include <atomic>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+const int ROOMS = 4;
+const int DEVICES = 64;
+const int WRITERS = 4;
+const int MOVES = 5000;
+
+int failures = 0;
+
+void expectEqual(const char* what, int actual, int expected) {
+    if (actual == expected) return;
+    std::cerr << "FAIL: " << what << ": " << actual << ", expected " << expected << std::endl;
+    failures++;
+}
+}
+
+int main() {
+    auto registry = std::make_shared<DeviceRegistry>();
+    std::vector<std::shared_ptr<Room>> rooms;
+    std::vector<std::shared_ptr<Device>> devices;
+    for (int r = 0; r < ROOMS; ++r) {
+        rooms.push_back(std::make_shared<Room>(r + 1, "Room " + std::to_string(r + 1)));
+        rooms.back()->attachRegistry(registry);
+    }
+    for (int d = 0; d < DEVICES; ++d) {
+        DeviceType type = d % 4 == 3 ? DeviceType::SENSOR : (d % 2 ? DeviceType::FAN : DeviceType::LIGHT);
+        devices.push_back(std::make_shared<Device>(d + 1, "Device " + std::to_string(d + 1), type));
+        rooms[static_cast<size_t>(d % ROOMS)]->addDevice(devices.back());
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<int> negativeSeen{0};
+    std::vector<std::thread> threads;
+    for (int w = 0; w < WRITERS; ++w) {
+        threads.emplace_back([&, w]() {
+            std::mt19937 rng(static_cast<unsigned>(w));
+            while (!stop.load()) {
+                Device& device = *devices[rng() % DEVICES];
+                if (rng() % 2) device.applyToggle(ChangeSource::MANUAL);
+                else device.apply(rng() % 2 ? deviceTraits(device.getType()).onState
+                                            : deviceTraits(device.getType()).offState);
+                if (registry->activeDeviceCount() < 0) negativeSeen++;
+            }
+        });
+    }
+
+    // moves go through remove/add (detach and re-attach) and through add with another
+    // room while still registered (setRoom)
+    std::vector<int> roomOf(DEVICES);
+    for (int d = 0; d < DEVICES; ++d) roomOf[static_cast<size_t>(d)] = d % ROOMS;
+    std::mt19937 rng(99);
+    for (int m = 0; m < MOVES; ++m) {
+        size_t d = rng() % DEVICES;
+        int to = static_cast<int>(rng() % ROOMS);
+        if (m % 2) {
+            rooms[static_cast<size_t>(roomOf[d])]->removeDevice(devices[d]->getId());
+            rooms[static_cast<size_t>(to)]->addDevice(devices[d]);
+            roomOf[d] = to;
+        } else {
+            registry->add(devices[d], rooms[static_cast<size_t>(roomOf[d])]);
+        }
+    }
+    stop = true;
+    for (auto& t : threads) t.join();
+
+    expectEqual("negative active counts observed", negativeSeen.load(), 0);
+    int active = 0;
+    for (const auto& device : devices)
+        if (device->getState() == deviceTraits(device->getType()).onState) active++;
+    expectEqual("house active count", registry->activeDeviceCount(), active);
+    expectEqual("house device count", registry->stateTable().deviceCount(), DEVICES);
+    for (int r = 0; r < ROOMS; ++r) {
+        int roomActive = 0, roomDevices = 0;
+        rooms[static_cast<size_t>(r)]->forEachDevice([&](const Device& device) {
+            roomDevices++;
+            if (device.getState() == deviceTraits(device.getType()).onState) roomActive++;
+        });
+        expectEqual("room active count", rooms[static_cast<size_t>(r)]->activeDeviceCount(), roomActive);
+        expectEqual("room device count", registry->stateTable().deviceCount(r + 1), roomDevices);
+    }
+    for (int t = 0; t < DEVICE_TYPE_COUNT; ++t) {
+        for (int s = 0; s < DEVICE_STATE_COUNT; ++s) {
+            int expected = 0;
+            for (const auto& device : devices)
+                if (static_cast<int>(device->getType()) == t && static_cast<int>(device->getState()) == s) expected++;
+            expectEqual("house count by type and state",
+                        registry->countDevices(static_cast<DeviceType>(t), static_cast<DeviceState>(s)), expected);
+        }
+    }
+
+    // a removed device stays usable and is not counted
+    rooms[static_cast<size_t>(roomOf[0])]->removeDevice(devices[0]->getId());
+    devices[0]->applyToggle();
+    expectEqual("device count after remove", registry->stateTable().deviceCount(), DEVICES - 1);
+
+    if (failures) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "DeviceStateStressTest passed" << std::endl;
+    return 0;
+}
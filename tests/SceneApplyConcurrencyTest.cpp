@@ -0,0 +1,86 @@
+// Concurrent transactional scene applies sharing one database connection.
+// Each thread applies scenes for its own room, so the applies never touch the
+// same devices and every one of them must commit.
+//
+// Build from the repository root:
+//   g++ -std=c++17 -I. -pthread tests/SceneApplyConcurrencyTest.cpp Device.cpp Room.cpp DeviceRegistry.cpp DeviceStateTable.cpp ChangeBus.cpp HomeArena.cpp SceneManager.cpp ThreadPool.cpp Scheduler.cpp DatabaseManager.cpp sqlite3.o -o SceneApplyConcurrencyTest
+#include "SceneManager.h"
+#include "DatabaseManager.h"
+#include "DeviceRegistry.h"
+#include <atomic>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace {
+const int ROOMS = 4;
+const int DEVICES_PER_ROOM = 8;
+const int APPLIES = 100;
+const char* DB_FILE = "scene_apply_concurrency_test.db";
+}
+
+int main() {
+    std::remove(DB_FILE);
+    auto database = std::make_shared<DatabaseManager>(DB_FILE);
+    auto registry = std::make_shared<DeviceRegistry>();
+    std::map<std::string, std::shared_ptr<Room>> rooms;
+    int nextId = 1;
+    for (int r = 0; r < ROOMS; ++r) {
+        auto room = std::make_shared<Room>(r + 1, "Room " + std::to_string(r + 1));
+        room->attachRegistry(registry);
+        for (int d = 0; d < DEVICES_PER_ROOM; ++d, ++nextId)
+            room->addDevice(std::make_shared<Device>(nextId, "Light " + std::to_string(nextId), DeviceType::LIGHT));
+        rooms[std::string(room->getName())] = room;
+    }
+
+    SceneManager scenes(rooms, registry, database);
+    for (const auto& entry : rooms) {
+        std::vector<SceneDeviceState> on, off;
+        entry.second->forEachDevice([&](const Device& device) {
+            on.push_back({device.getId(), DeviceState::ON});
+            off.push_back({device.getId(), DeviceState::OFF});
+        });
+        std::string error;
+        if (!scenes.createScene(entry.first + " on", SceneType::ROOM, entry.first, on, &error) ||
+            !scenes.createScene(entry.first + " off", SceneType::ROOM, entry.first, off, &error)) {
+            std::cerr << "FAIL: creating scenes: " << error << std::endl;
+            return 1;
+        }
+    }
+
+    std::atomic<int> failures{0};
+    std::vector<std::thread> threads;
+    for (const auto& entry : rooms) {
+        std::string room = entry.first;
+        threads.emplace_back([&, room]() {
+            for (int i = 0; i < APPLIES; ++i) {
+                SceneApplyResult result = scenes.applyScene(room + (i % 2 ? " off" : " on"),
+                                                            SceneApplyMode::TRANSACTIONAL);
+                if (!result.applied || result.rolledBack) {
+                    if (failures++ == 0) std::cerr << "FAIL: " << room << ": " << result.error << std::endl;
+                }
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    // the last apply of every room was "off", and that is what was saved
+    int saved = 0;
+    for (const auto& entry : rooms)
+        for (const auto& device : database->loadDevices(entry.second->getId()))
+            if (device->getState() == DeviceState::OFF) saved++;
+    if (saved != ROOMS * DEVICES_PER_ROOM) {
+        std::cerr << "FAIL: saved off devices: " << saved << ", expected " << ROOMS * DEVICES_PER_ROOM << std::endl;
+        failures++;
+    }
+
+    database.reset();
+    std::remove(DB_FILE);
+    if (failures) {
+        std::cerr << failures << " apply(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "SceneApplyConcurrencyTest passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,77 @@
+// Supersession of timed scene transitions. Devices 1 and 65 share a lock
+// stripe (id % 64), so a scene touching only device 65 must leave a transition
+// over devices 1-4 running, while one touching device 2 must cancel it.
+//
+// Build from the repository root:
+//   g++ -std=c++17 -I. -pthread tests/SceneTransitionTest.cpp Device.cpp Room.cpp DeviceRegistry.cpp DeviceStateTable.cpp ChangeBus.cpp HomeArena.cpp SceneManager.cpp ThreadPool.cpp Scheduler.cpp DatabaseManager.cpp sqlite3.o -o SceneTransitionTest
+#include "SceneManager.h"
+#include "DeviceRegistry.h"
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace {
+int failures = 0;
+
+void expectEqual(const char* what, long actual, long expected) {
+    if (actual == expected) return;
+    std::cerr << "FAIL: " << what << ": " << actual << ", expected " << expected << std::endl;
+    failures++;
+}
+}
+
+int main() {
+    auto registry = std::make_shared<DeviceRegistry>();
+    std::map<std::string, std::shared_ptr<Room>> rooms;
+    auto roomA = std::make_shared<Room>(1, "Room A");
+    auto roomB = std::make_shared<Room>(2, "Room B");
+    roomA->attachRegistry(registry);
+    roomB->attachRegistry(registry);
+    for (int id = 1; id <= 4; ++id)
+        roomA->addDevice(std::make_shared<Device>(id, "Light " + std::to_string(id), DeviceType::LIGHT));
+    roomB->addDevice(std::make_shared<Device>(65, "Light 65", DeviceType::LIGHT));
+    rooms["Room A"] = roomA;
+    rooms["Room B"] = roomB;
+
+    auto scheduler = std::make_shared<Scheduler>();
+    std::thread loop([&]() { scheduler->runLoop(); });
+    {
+        SceneManager scenes(rooms, registry);
+        scenes.setScheduler(scheduler);
+        std::vector<SceneDeviceState> aOn, aSecondOff;
+        for (int id = 1; id <= 4; ++id) aOn.push_back({id, DeviceState::ON});
+        aSecondOff.push_back({2, DeviceState::OFF});
+        scenes.createScene("A on", SceneType::ROOM, "Room A", aOn);
+        scenes.createScene("A second off", SceneType::ROOM, "Room A", aSecondOff);
+        scenes.createScene("B on", SceneType::ROOM, "Room B", {{65, DeviceState::ON}});
+
+        SceneTransition staggered;
+        staggered.mode = SceneTransitionMode::STAGGERED;
+        staggered.devicesPerStep = 1;
+        staggered.interval = std::chrono::milliseconds(30);
+
+        // same stripe, different device: the transition keeps running
+        scenes.applyScene("A on", staggered);
+        scenes.applyScene("B on");
+        expectEqual("transitions after an apply on a colliding stripe", static_cast<long>(scenes.activeTransitionCount()), 1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        expectEqual("active devices after the transition", registry->activeDeviceCount(), 5);
+        expectEqual("transitions after completion", static_cast<long>(scenes.activeTransitionCount()), 0);
+
+        // a shared device: the transition is cancelled
+        scenes.applyScene("A second off");
+        for (int id = 1; id <= 4; ++id) registry->find(id)->apply(DeviceState::OFF);
+        scenes.applyScene("A on", staggered);
+        scenes.applyScene("A second off");
+        expectEqual("transitions after an apply on a shared device", static_cast<long>(scenes.activeTransitionCount()), 0);
+    }
+    scheduler->stop();
+    loop.join();
+
+    if (failures) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "SceneTransitionTest passed" << std::endl;
+    return 0;
+}